@@ -0,0 +1,243 @@
+#ifndef KOUEK_FRAME_PROFILER_H
+#define KOUEK_FRAME_PROFILER_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace kouek {
+/// <summary>
+/// CPU and GPU time of named passes in each frame.
+/// CPU time is measured by steady_clock around a scope, and GPU time by a
+/// pair of GL_TIMESTAMP queries around the same scope. Queries of a frame
+/// are read LATENCY frames later, and only if available, thus profiling
+/// never stalls the pipeline.
+/// When disabled, Scope() returns an empty guard and nothing else is done.
+/// Each pass should be scoped at most once per frame.
+/// </summary>
+class FrameProfiler {
+  public:
+    static constexpr uint8_t LATENCY = 4;
+    static constexpr size_t WINDOW = 120;
+    struct Stats {
+        float cpuAvgMS = 0, cpuMaxMS = 0;
+        float gpuAvgMS = 0, gpuMaxMS = 0;
+    };
+
+  private:
+    static constexpr auto NONE = std::numeric_limits<uint64_t>::max();
+    using Clock = std::chrono::steady_clock;
+
+    /// <summary>
+    /// Rolling window of the last WINDOW samples
+    /// </summary>
+    class Rolling {
+      private:
+        std::array<float, WINDOW> vals{};
+        size_t cnt = 0, next = 0;
+
+      public:
+        void Push(float val) {
+            vals[next] = val;
+            next = (next + 1) % WINDOW;
+            cnt = std::min(cnt + 1, WINDOW);
+        }
+        float Avg() const {
+            float sum = 0;
+            for (size_t i = 0; i < cnt; ++i)
+                sum += vals[i];
+            return cnt == 0 ? 0 : sum / cnt;
+        }
+        float Max() const {
+            return cnt == 0 ? 0 : *std::max_element(vals.begin(),
+                                                    vals.begin() + cnt);
+        }
+    };
+    struct Sample {
+        bool used = false;
+        float cpuMS = 0;
+    };
+
+    bool enabled = false;
+    uint8_t slot = 0;
+    uint64_t frameIdx = 0;
+    Clock::time_point frameStart;
+    std::vector<std::string> passNames;
+    /// <summary>
+    /// [slot][pass][begin, end], created on first enabling
+    /// </summary>
+    std::vector<GLuint> queries;
+    std::vector<Sample> samples;
+    std::array<uint64_t, LATENCY> slotFrameIdxs;
+    std::vector<Rolling> cpuStats, gpuStats;
+    Rolling frameStat;
+    std::ofstream log;
+
+  public:
+    /// <summary>
+    /// RAII scope of a pass. Empty if profiler is disabled.
+    /// </summary>
+    class ScopedPass {
+      private:
+        FrameProfiler *prof;
+        size_t passIdx;
+        Clock::time_point start;
+
+        ScopedPass(FrameProfiler *prof, size_t passIdx)
+            : prof(prof), passIdx(passIdx) {
+            if (!prof)
+                return;
+            glQueryCounter(prof->getQuery(passIdx, 0), GL_TIMESTAMP);
+            start = Clock::now();
+        }
+        friend class FrameProfiler;
+
+      public:
+        ScopedPass(const ScopedPass &) = delete;
+        ScopedPass &operator=(const ScopedPass &) = delete;
+        ~ScopedPass() {
+            if (!prof)
+                return;
+            auto &sample = prof->getSample(passIdx);
+            sample.cpuMS += std::chrono::duration<float, std::milli>(
+                                Clock::now() - start)
+                                .count();
+            sample.used = true;
+            glQueryCounter(prof->getQuery(passIdx, 1), GL_TIMESTAMP);
+        }
+    };
+
+    FrameProfiler(std::vector<std::string> passNames)
+        : passNames(std::move(passNames)),
+          samples(LATENCY * this->passNames.size()),
+          cpuStats(this->passNames.size()), gpuStats(this->passNames.size()) {
+        slotFrameIdxs.fill(NONE);
+    }
+    ~FrameProfiler() {
+        if (!queries.empty())
+            glDeleteQueries(queries.size(), queries.data());
+    }
+    FrameProfiler(const FrameProfiler &) = delete;
+    FrameProfiler &operator=(const FrameProfiler &) = delete;
+    /// <summary>
+    /// Samples are appended to logPath as CSV if it is not empty
+    /// </summary>
+    void SetEnabled(bool enabled, const std::string &logPath = {}) {
+        this->enabled = enabled;
+        if (log.is_open())
+            log.close();
+        slotFrameIdxs.fill(NONE);
+        for (auto &sample : samples)
+            sample = Sample();
+        if (!enabled)
+            return;
+
+        if (queries.empty()) {
+            queries.resize(2 * LATENCY * passNames.size());
+            glGenQueries(queries.size(), queries.data());
+        }
+        if (!logPath.empty()) {
+            log.open(logPath, std::ios::out | std::ios::trunc);
+            log << "frame,pass,cpu_ms,gpu_ms\n";
+        }
+    }
+    inline auto IsEnabled() const { return enabled; }
+    inline ScopedPass Scope(size_t passIdx) {
+        return ScopedPass(enabled ? this : nullptr, passIdx);
+    }
+    void BeginFrame() {
+        if (!enabled)
+            return;
+        slot = frameIdx % LATENCY;
+        collect();
+        frameStart = Clock::now();
+    }
+    void EndFrame() {
+        if (!enabled)
+            return;
+        frameStat.Push(
+            std::chrono::duration<float, std::milli>(Clock::now() - frameStart)
+                .count());
+        slotFrameIdxs[slot] = frameIdx++;
+    }
+    inline Stats GetStats(size_t passIdx) const {
+        return {cpuStats[passIdx].Avg(), cpuStats[passIdx].Max(),
+                gpuStats[passIdx].Avg(), gpuStats[passIdx].Max()};
+    }
+    inline auto GetFrameCPUAvgMS() const { return frameStat.Avg(); }
+    /// <summary>
+    /// One line per pass, for overlays
+    /// </summary>
+    std::string FormatStats() const {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "Frame CPU avg " << frameStat.Avg() << " max " << frameStat.Max()
+           << " ms\n";
+        ss << "Pass          CPU avg/max      GPU avg/max (ms)\n";
+        for (size_t passIdx = 0; passIdx < passNames.size(); ++passIdx) {
+            auto stats = GetStats(passIdx);
+            ss << std::left << std::setw(12) << passNames[passIdx]
+               << std::right << std::setw(8) << stats.cpuAvgMS << '/'
+               << std::setw(7) << stats.cpuMaxMS << std::setw(9)
+               << stats.gpuAvgMS << '/' << std::setw(7) << stats.gpuMaxMS
+               << '\n';
+        }
+        return ss.str();
+    }
+
+  private:
+    inline GLuint getQuery(size_t passIdx, uint8_t beginOrEnd) const {
+        return queries[2 * (slot * passNames.size() + passIdx) + beginOrEnd];
+    }
+    inline Sample &getSample(size_t passIdx) {
+        return samples[slot * passNames.size() + passIdx];
+    }
+    /// <summary>
+    /// Read back the frame issued LATENCY frames ago in slot, then reset
+    /// the slot for reusing
+    /// </summary>
+    void collect() {
+        if (slotFrameIdxs[slot] == NONE)
+            return;
+        for (size_t passIdx = 0; passIdx < passNames.size(); ++passIdx) {
+            auto &sample = getSample(passIdx);
+            if (!sample.used)
+                continue;
+            cpuStats[passIdx].Push(sample.cpuMS);
+
+            GLint available;
+            glGetQueryObjectiv(getQuery(passIdx, 1),
+                               GL_QUERY_RESULT_AVAILABLE, &available);
+            float gpuMS = -1.f;
+            if (available) {
+                GLuint64 begin, end;
+                glGetQueryObjectui64v(getQuery(passIdx, 0), GL_QUERY_RESULT,
+                                      &begin);
+                glGetQueryObjectui64v(getQuery(passIdx, 1), GL_QUERY_RESULT,
+                                      &end);
+                gpuMS = (end - begin) * 1e-6f;
+                gpuStats[passIdx].Push(gpuMS);
+            }
+            if (log.is_open()) {
+                log << slotFrameIdxs[slot] << ',' << passNames[passIdx] << ','
+                    << sample.cpuMS << ',';
+                if (available)
+                    log << gpuMS;
+                log << '\n';
+            }
+            sample = Sample();
+        }
+        slotFrameIdxs[slot] = NONE;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_FRAME_PROFILER_H
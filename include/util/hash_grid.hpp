@@ -0,0 +1,283 @@
+#ifndef KOUEK_HASH_GRID_H
+#define KOUEK_HASH_GRID_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <util/math.h>
+
+namespace kouek {
+/// <summary>
+/// Uniform grid over [min, max] whose cells are hashed into a table of
+/// buckets. Points are stored bucket by bucket in one array, so a cell is
+/// scanned as a contiguous range. Buckets may be shared by several cells,
+/// thus points are always filtered by their own cell or position.
+/// Built once in parallel and immutable afterwards. Unlike PointOctree,
+/// duplicate points are all kept.
+/// </summary>
+template <typename VertDatTy> class HashGrid {
+  public:
+    static constexpr float DEFAULT_AVG_DAT_NUM_PER_CELL = 4.f;
+
+  private:
+    float cellSize, invCellSize;
+    uint32_t hashMask;
+    glm::vec3 min, max;
+    glm::ivec3 dim;
+    /// <summary>
+    /// Points in bucket b are in range [bucketStarts[b], bucketStarts[b+1])
+    /// </summary>
+    std::vector<uint32_t> bucketStarts;
+    std::vector<std::pair<glm::vec3, VertDatTy>> dat;
+
+  public:
+    /// <summary>
+    /// Points out of bound are dropped.
+    /// cellSize <= 0 chooses one holding DEFAULT_AVG_DAT_NUM_PER_CELL
+    /// points on average if they are uniform in their own AABB.
+    /// threadNum == 0 uses all hardware threads.
+    /// </summary>
+    HashGrid(const glm::vec3 &min, const glm::vec3 &max,
+             std::vector<std::pair<glm::vec3, VertDatTy>> dat,
+             float cellSize = 0, uint32_t threadNum = 0)
+        : min(min), max(max) {
+        dat.erase(std::remove_if(dat.begin(), dat.end(),
+                                 [&](const auto &d) {
+                                     return isOutOfBound(d.first);
+                                 }),
+                  dat.end());
+        auto ext = max - min;
+        if (cellSize <= 0) {
+            glm::vec3 datMin = max, datMax = min;
+            for (const auto &d : dat) {
+                datMin = glm::min(datMin, d.first);
+                datMax = glm::max(datMax, d.first);
+            }
+            auto datExt = glm::max(datMax - datMin, glm::vec3{1e-3f} * ext);
+            auto vol = std::max(datExt.x, std::numeric_limits<float>::min()) *
+                       std::max(datExt.y, std::numeric_limits<float>::min()) *
+                       std::max(datExt.z, std::numeric_limits<float>::min());
+            cellSize = cbrtf(vol * DEFAULT_AVG_DAT_NUM_PER_CELL /
+                             std::max(dat.size(), (size_t)1));
+        }
+        this->cellSize = cellSize;
+        invCellSize = 1.f / cellSize;
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            this->dim[xyz] = std::max(
+                1, static_cast<int>(std::ceil(ext[xyz] * invCellSize)));
+
+        uint32_t tableSize = 1;
+        while (tableSize < dat.size())
+            tableSize <<= 1;
+        hashMask = tableSize - 1;
+
+        if (threadNum == 0)
+            threadNum = std::max(std::thread::hardware_concurrency(), 1u);
+        build(std::move(dat), tableSize, threadNum);
+    }
+    inline auto GetCellSize() const { return cellSize; }
+    inline auto GetDim() const { return dim; }
+    inline auto GetDatNum() const { return dat.size(); }
+    /// <summary>
+    /// Return the stored point nearest to pos within maxSqrErr,
+    /// or nullptr. Only the cell of pos is searched.
+    /// </summary>
+    const std::pair<glm::vec3, VertDatTy> *
+    Query(const glm::vec3 &pos,
+          float maxSqrErr = std::numeric_limits<float>::epsilon()) const {
+        if (isOutOfBound(pos))
+            return nullptr;
+        auto bucket = hash(getCell(pos));
+        const std::pair<glm::vec3, VertDatTy> *ret = nullptr;
+        float minSqrErr = std::numeric_limits<float>::max();
+        for (auto idx = bucketStarts[bucket]; idx < bucketStarts[bucket + 1];
+             ++idx) {
+            auto dlt = dat[idx].first - pos;
+            auto sqrErr = glm::dot(dlt, dlt);
+            if (sqrErr <= maxSqrErr && sqrErr < minSqrErr) {
+                minSqrErr = sqrErr;
+                ret = &dat[idx];
+            }
+        }
+        return ret;
+    }
+    /// <summary>
+    /// Append data of points inside frustum to ret.
+    /// Cell ranges are halved recursively as an implicit octree, and
+    /// faces which a range lies totally inside are not tested again.
+    /// </summary>
+    void QueryDat(const Frustum &frustum, std::vector<VertDatTy> &ret) const {
+        if (dat.empty())
+            return;
+        queryRange(frustum, glm::ivec3{0}, dim, Frustum::ALL_FACES_MASK,
+                   ret);
+    }
+    std::vector<VertDatTy> QueryDat(const Frustum &frustum) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(frustum, ret);
+        return ret;
+    }
+    /// <summary>
+    /// Append data of points inside sphere (cntr, radius) to ret
+    /// </summary>
+    void QueryDat(const glm::vec3 &cntr, float radius,
+                  std::vector<VertDatTy> &ret) const {
+        if (dat.empty())
+            return;
+        auto sqrRadius = radius * radius;
+        auto lo = getCell(glm::max(cntr - radius, min));
+        auto hi = getCell(glm::min(cntr + radius, max)) + glm::ivec3{1};
+        forEachInRange(lo, hi, [&](const auto &d) {
+            auto dlt = d.first - cntr;
+            if (glm::dot(dlt, dlt) <= sqrRadius)
+                ret.emplace_back(d.second);
+        });
+    }
+    std::vector<VertDatTy> QueryDat(const glm::vec3 &cntr,
+                                    float radius) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(cntr, radius, ret);
+        return ret;
+    }
+
+  private:
+    template <typename Func>
+    static void parallelFor(size_t num, uint32_t threadNum, Func &&func) {
+        if (threadNum <= 1 || num < threadNum) {
+            func(0, num);
+            return;
+        }
+        std::vector<std::thread> threads;
+        threads.reserve(threadNum);
+        auto chunk = (num + threadNum - 1) / threadNum;
+        for (size_t beg = 0; beg < num; beg += chunk)
+            threads.emplace_back(func, beg, std::min(beg + chunk, num));
+        for (auto &thread : threads)
+            thread.join();
+    }
+    /// <summary>
+    /// Counting sort points by bucket. Counting and scattering run in
+    /// parallel with atomic counters, the prefix sum runs serially.
+    /// </summary>
+    void build(std::vector<std::pair<glm::vec3, VertDatTy>> &&src,
+               uint32_t tableSize, uint32_t threadNum) {
+        std::vector<uint32_t> buckets(src.size());
+        std::vector<std::atomic<uint32_t>> cnts(tableSize);
+        parallelFor(src.size(), threadNum, [&](size_t beg, size_t end) {
+            for (auto idx = beg; idx < end; ++idx) {
+                buckets[idx] = hash(getCell(src[idx].first));
+                cnts[buckets[idx]].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        bucketStarts.resize(tableSize + 1);
+        bucketStarts[0] = 0;
+        for (uint32_t bucket = 0; bucket < tableSize; ++bucket) {
+            bucketStarts[bucket + 1] = bucketStarts[bucket] + cnts[bucket];
+            cnts[bucket] = bucketStarts[bucket];
+        }
+
+        dat.resize(src.size());
+        parallelFor(src.size(), threadNum, [&](size_t beg, size_t end) {
+            for (auto idx = beg; idx < end; ++idx)
+                dat[cnts[buckets[idx]].fetch_add(
+                    1, std::memory_order_relaxed)] = std::move(src[idx]);
+        });
+    }
+    void queryRange(const Frustum &frustum, const glm::ivec3 &lo,
+                    const glm::ivec3 &hi, uint8_t planeMask,
+                    std::vector<VertDatTy> &ret) const {
+        glm::vec3 rangeMin = min + glm::vec3(lo) * cellSize;
+        glm::vec3 rangeMax = min + glm::vec3(hi) * cellSize;
+        if (planeMask != 0 &&
+            !frustum.IsIntersectedWithAABB(rangeMin, rangeMax, planeMask))
+            return;
+
+        auto ext = hi - lo;
+        if (planeMask != 0 && (ext.x > 1 || ext.y > 1 || ext.z > 1) &&
+            !isSparse(lo, hi)) {
+            uint8_t axis = ext.x >= ext.y && ext.x >= ext.z ? 0
+                           : ext.y >= ext.z                 ? 1
+                                                            : 2;
+            auto midHi = hi, midLo = lo;
+            midHi[axis] = midLo[axis] = lo[axis] + ext[axis] / 2;
+            queryRange(frustum, lo, midHi, planeMask, ret);
+            queryRange(frustum, midLo, hi, planeMask, ret);
+            return;
+        }
+
+        forEachInRange(lo, hi, [&](const auto &d) {
+            if (planeMask == 0 || frustum.IsIntersetcedWith(d.first, planeMask))
+                ret.emplace_back(d.second);
+        });
+    }
+    /// <summary>
+    /// A range holding more cells than points, e.g. when points cluster in
+    /// a small part of [min, max], is cheaper to scan point by point than
+    /// cell by cell
+    /// </summary>
+    inline bool isSparse(const glm::ivec3 &lo, const glm::ivec3 &hi) const {
+        auto ext = hi - lo;
+        return static_cast<double>(ext.x) * ext.y * ext.z > dat.size();
+    }
+    /// <summary>
+    /// Call func on points in cells [lo, hi), thus the cost is bounded by
+    /// the number of points however many cells are empty
+    /// </summary>
+    template <typename Func>
+    void forEachInRange(const glm::ivec3 &lo, const glm::ivec3 &hi,
+                        Func &&func) const {
+        if (isSparse(lo, hi)) {
+            for (const auto &d : dat) {
+                auto cell = getCell(d.first);
+                if (cell.x >= lo.x && cell.y >= lo.y && cell.z >= lo.z &&
+                    cell.x < hi.x && cell.y < hi.y && cell.z < hi.z)
+                    func(d);
+            }
+            return;
+        }
+        glm::ivec3 cell;
+        for (cell.z = lo.z; cell.z < hi.z; ++cell.z)
+            for (cell.y = lo.y; cell.y < hi.y; ++cell.y)
+                for (cell.x = lo.x; cell.x < hi.x; ++cell.x)
+                    forEachInCell(cell, func);
+    }
+    template <typename Func>
+    inline void forEachInCell(const glm::ivec3 &cell, Func &&func) const {
+        auto bucket = hash(cell);
+        for (auto idx = bucketStarts[bucket]; idx < bucketStarts[bucket + 1];
+             ++idx)
+            if (getCell(dat[idx].first) == cell)
+                func(dat[idx]);
+    }
+    inline bool isOutOfBound(const glm::vec3 &pos) const {
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            if (pos[xyz] < min[xyz] || pos[xyz] > max[xyz])
+                return true;
+        return false;
+    }
+    inline glm::ivec3 getCell(const glm::vec3 &pos) const {
+        glm::ivec3 cell;
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            cell[xyz] = std::clamp(
+                static_cast<int>((pos[xyz] - min[xyz]) * invCellSize), 0,
+                dim[xyz] - 1);
+        return cell;
+    }
+    inline uint32_t hash(const glm::ivec3 &cell) const {
+        return ((uint32_t)cell.x * 73856093u ^ (uint32_t)cell.y * 19349663u ^
+                (uint32_t)cell.z * 83492791u) &
+               hashMask;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_HASH_GRID_H
@@ -0,0 +1,118 @@
+#ifndef KOUEK_MAPPED_FILE_H
+#define KOUEK_MAPPED_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kouek {
+/// <summary>
+/// Read-only memory mapping of a whole file, unmapped on destruction.
+/// Pages are read from disk by the OS on first access, thus mapping a file
+/// larger than memory costs nothing until it is touched.
+/// </summary>
+class MappedFile {
+  private:
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+  public:
+    MappedFile(const std::string &filePath) {
+#ifdef _WIN32
+        file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open file: " + filePath);
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        mapping =
+            CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            base = static_cast<const uint8_t *>(
+                MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!base) {
+            unmap();
+            throw std::runtime_error("Cannot map file: " + filePath);
+        }
+#else
+        int fd = open(filePath.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::runtime_error("Cannot open file: " + filePath);
+        struct stat fileStat;
+        fstat(fd, &fileStat);
+        size = static_cast<size_t>(fileStat.st_size);
+        void *ptr =
+            size == 0 ? MAP_FAILED
+                      : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // mapping stays valid after closing
+        if (ptr == MAP_FAILED)
+            throw std::runtime_error("Cannot map file: " + filePath);
+        base = static_cast<const uint8_t *>(ptr);
+#endif
+    }
+    ~MappedFile() { unmap(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    inline auto GetData() const { return base; }
+    inline auto GetSize() const { return size; }
+    /// <summary>
+    /// Ask the OS to read [offs, offs + len) ahead of access, without
+    /// blocking. Only a hint, which may be ignored.
+    /// </summary>
+    void Prefetch(size_t offs, size_t len) const {
+        if (offs >= size)
+            return;
+        len = std::min(len, size - offs);
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<uint8_t *>(base) + offs,
+                                       len};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        // madvise() requires a page-aligned start
+        auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto alignedOffs = offs / pageSize * pageSize;
+        posix_madvise(const_cast<uint8_t *>(base) + alignedOffs,
+                      len + offs - alignedOffs, POSIX_MADV_WILLNEED);
+#endif
+    }
+
+  private:
+    void unmap() {
+#ifdef _WIN32
+        if (base)
+            UnmapViewOfFile(base);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base)
+            munmap(const_cast<uint8_t *>(base), size);
+#endif
+        base = nullptr;
+        size = 0;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_MAPPED_FILE_H
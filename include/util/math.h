@@ -1,7 +1,20 @@
 #ifndef KOUEK_MATH_H
 #define KOUEK_MATH_H
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define KOUEK_FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KOUEK_FRUSTUM_SIMD_WIDTH 4
+#else
+#define KOUEK_FRUSTUM_SIMD_WIDTH 1
+#endif
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -88,6 +101,7 @@ struct Frustum {
     /// Left, Right, Bottom and Top faces
     /// </summary>
     std::array<std::array<float, 4>, 6> coeffs;
+    static constexpr uint8_t ALL_FACES_MASK = 0x3f;
 
     Frustum(const glm::vec3 &startPos, const glm::vec3 &forward, float n,
             float f, const glm::vec3 &LBDrc, const glm::vec3 &LTDrc,
@@ -131,6 +145,26 @@ struct Frustum {
         coeffs[5][2] = norm.z;
         coeffs[5][3] = -glm::dot(norm, pos);
     }
+    /// <summary>
+    /// Clip volume of M, e.g. proj * view * model, whose faces are in the
+    /// space M transforms from. Coefficients are normalized, thus they
+    /// give signed distances to faces.
+    /// </summary>
+    Frustum(const glm::mat4 &M) {
+        auto row = [&](uint8_t r) {
+            return glm::vec4{M[0][r], M[1][r], M[2][r], M[3][r]};
+        };
+        // a point is inside if -w <= x, y, z <= w in clip space
+        std::array<glm::vec4, 6> planes{
+            -(row(3) + row(2)), -(row(3) - row(2)), -(row(3) + row(0)),
+            -(row(3) - row(0)), -(row(3) + row(1)), -(row(3) - row(1))};
+        for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx) {
+            auto &plane = planes[faceIdx];
+            plane /= glm::length(glm::vec3(plane));
+            for (uint8_t i = 0; i < 4; ++i)
+                coeffs[faceIdx][i] = plane[i];
+        }
+    }
     inline bool IsIntersetcedWith(const glm::vec3 &pos) const {
         bool intersected = true;
         for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx) {
@@ -143,6 +177,19 @@ struct Frustum {
         }
         return intersected;
     }
+    /// <summary>
+    /// Only faces whose bits are set in planeMask are tested
+    /// </summary>
+    inline bool IsIntersetcedWith(const glm::vec3 &pos,
+                                  uint8_t planeMask) const {
+        for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx)
+            if ((planeMask & (0x1 << faceIdx)) != 0 &&
+                coeffs[faceIdx][0] * pos.x + coeffs[faceIdx][1] * pos.y +
+                        coeffs[faceIdx][2] * pos.z + coeffs[faceIdx][3] >
+                    0)
+                return false;
+        return true;
+    }
     inline bool IsIntersectedWithAABB(const glm::vec3 &min,
                                       const glm::vec3 &max) const {
         auto compute = [&](uint8_t faceIdx, const glm::vec3 &pos) {
@@ -159,6 +206,136 @@ struct Frustum {
         }
         return true;
     }
+    /// <summary>
+    /// Only faces whose bits are set in planeMask are tested.
+    /// If AABB intersects, bits of faces which AABB lies totally inside
+    /// are cleared, thus the sub-volumes of AABB can skip those faces.
+    /// planeMask becomes 0 when AABB is totally inside the frustum.
+    /// </summary>
+    inline bool IsIntersectedWithAABB(const glm::vec3 &min,
+                                      const glm::vec3 &max,
+                                      uint8_t &planeMask) const {
+        auto compute = [&](uint8_t faceIdx, const glm::vec3 &pos) {
+            return coeffs[faceIdx][0] * pos.x + coeffs[faceIdx][1] * pos.y +
+                   coeffs[faceIdx][2] * pos.z + coeffs[faceIdx][3];
+        };
+        glm::vec3 farPos, nearPos;
+        for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx) {
+            if ((planeMask & (0x1 << faceIdx)) == 0)
+                continue;
+            for (uint8_t xyz = 0; xyz < 3; ++xyz)
+                if (coeffs[faceIdx][xyz] > 0) {
+                    farPos[xyz] = min[xyz];
+                    nearPos[xyz] = max[xyz];
+                } else {
+                    farPos[xyz] = max[xyz];
+                    nearPos[xyz] = min[xyz];
+                }
+            if (compute(faceIdx, farPos) > 0)
+                return false;
+            if (compute(faceIdx, nearPos) <= 0)
+                planeMask &= ~(0x1 << faceIdx);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Points are tested in batches of MASK_BIT_NUM.
+    /// Bit (i % MASK_BIT_NUM) of mask[i / MASK_BIT_NUM] is set
+    /// if and only if point i is inside.
+    /// </summary>
+    static constexpr size_t MASK_BIT_NUM = 64;
+    static constexpr size_t GetMaskWordNum(size_t num) {
+        return (num + MASK_BIT_NUM - 1) / MASK_BIT_NUM;
+    }
+    /// <summary>
+    /// Batch version of IsIntersetcedWith(pos) over SoA points.
+    /// mask should hold GetMaskWordNum(num) words.
+    /// </summary>
+    inline void IsIntersetcedWith(const float *xs, const float *ys,
+                                  const float *zs, size_t num,
+                                  uint64_t *mask) const {
+        for (size_t start = 0; start < num; start += MASK_BIT_NUM)
+            mask[start / MASK_BIT_NUM] =
+                testBatch(xs + start, ys + start, zs + start,
+                          std::min(num - start, MASK_BIT_NUM));
+    }
+    /// <summary>
+    /// Batch version of IsIntersetcedWith(pos) over AoS points, which are
+    /// transposed to SoA batch by batch on stack
+    /// </summary>
+    inline void IsIntersetcedWith(const glm::vec3 *poss, size_t num,
+                                  uint64_t *mask) const {
+        alignas(32) std::array<std::array<float, MASK_BIT_NUM>, 3> soa;
+        for (size_t start = 0; start < num; start += MASK_BIT_NUM) {
+            auto batchNum = std::min(num - start, MASK_BIT_NUM);
+            for (size_t i = 0; i < batchNum; ++i)
+                for (uint8_t xyz = 0; xyz < 3; ++xyz)
+                    soa[xyz][i] = poss[start + i][xyz];
+            mask[start / MASK_BIT_NUM] =
+                testBatch(soa[0].data(), soa[1].data(), soa[2].data(),
+                          batchNum);
+        }
+    }
+
+  private:
+    /// <summary>
+    /// Test at most MASK_BIT_NUM points. Lanes are tested against all faces
+    /// without branches, and the remainder falls back to scalar.
+    /// </summary>
+    inline uint64_t testBatch(const float *xs, const float *ys,
+                              const float *zs, size_t num) const {
+        uint64_t bits = 0;
+        size_t i = 0;
+#if KOUEK_FRUSTUM_SIMD_WIDTH == 8
+        __m256 c[6][4];
+        for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx)
+            for (uint8_t j = 0; j < 4; ++j)
+                c[faceIdx][j] = _mm256_set1_ps(coeffs[faceIdx][j]);
+        auto zero = _mm256_setzero_ps();
+        for (; i + 8 <= num; i += 8) {
+            auto x = _mm256_loadu_ps(xs + i);
+            auto y = _mm256_loadu_ps(ys + i);
+            auto z = _mm256_loadu_ps(zs + i);
+            auto in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx) {
+                auto d = _mm256_add_ps(
+                    _mm256_add_ps(
+                        _mm256_add_ps(_mm256_mul_ps(c[faceIdx][0], x),
+                                      _mm256_mul_ps(c[faceIdx][1], y)),
+                        _mm256_mul_ps(c[faceIdx][2], z)),
+                    c[faceIdx][3]);
+                in = _mm256_and_ps(in, _mm256_cmp_ps(d, zero, _CMP_LE_OQ));
+            }
+            bits |= static_cast<uint64_t>(_mm256_movemask_ps(in)) << i;
+        }
+#elif KOUEK_FRUSTUM_SIMD_WIDTH == 4
+        __m128 c[6][4];
+        for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx)
+            for (uint8_t j = 0; j < 4; ++j)
+                c[faceIdx][j] = _mm_set1_ps(coeffs[faceIdx][j]);
+        auto zero = _mm_setzero_ps();
+        for (; i + 4 <= num; i += 4) {
+            auto x = _mm_loadu_ps(xs + i);
+            auto y = _mm_loadu_ps(ys + i);
+            auto z = _mm_loadu_ps(zs + i);
+            auto in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (uint8_t faceIdx = 0; faceIdx < 6; ++faceIdx) {
+                auto d = _mm_add_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[faceIdx][0], x),
+                                          _mm_mul_ps(c[faceIdx][1], y)),
+                               _mm_mul_ps(c[faceIdx][2], z)),
+                    c[faceIdx][3]);
+                in = _mm_and_ps(in, _mm_cmple_ps(d, zero));
+            }
+            bits |= static_cast<uint64_t>(_mm_movemask_ps(in)) << i;
+        }
+#endif
+        for (; i < num; ++i)
+            if (IsIntersetcedWith(glm::vec3{xs[i], ys[i], zs[i]}))
+                bits |= uint64_t(1) << i;
+        return bits;
+    }
 };
 
 } // namespace kouek
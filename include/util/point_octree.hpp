@@ -1,22 +1,36 @@
 #ifndef KOUEK_POINT_OCTREE_H
 #define KOUEK_POINT_OCTREE_H
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cmath>
+#include <functional>
 #include <iostream>
 #include <queue>
 #include <stack>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <util/math.h>
+
 namespace kouek {
-template <typename VertDatTy> class PointOctree {
-  public:
-    template <typename VertDatTy> struct Node {
-        static constexpr uint8_t DEFAULT_DAT_CAP = 2;
+/// <summary>
+/// LeafCap is the max number of points stored in a leaf before it splits.
+/// It is fixed at compile time so that leaf payloads live inline in the
+/// node and loops over a leaf have a constant bound.
+/// </summary>
+template <typename VertDatTy, uint8_t LeafCap = 8> class PointOctree {
+    static_assert(LeafCap > 1, "LeafCap of PointOctree should be at least 2");
 
+  public:
+    struct Node {
         glm::vec3 min, max;
-        uint8_t datNum = 0, datCap = DEFAULT_DAT_CAP;
-        std::pair<glm::vec3, VertDatTy> *dat = nullptr;
+        uint8_t datNum = 0;
+        std::array<std::pair<glm::vec3, VertDatTy>, LeafCap> dat;
         /// <summary>
         ///       /|\
         ///   010  |   011
@@ -27,47 +41,104 @@ template <typename VertDatTy> class PointOctree {
         ///    |/_
         /// </summary>
         std::array<Node *, 8> children{nullptr};
+        Node *parent;
 
-        Node(const glm::vec3 &min, const glm::vec3 &max) : min(min), max(max) {
-            dat = new std::pair<glm::vec3, VertDatTy>[datCap];
-        }
-        ~Node() { Clear(); }
+        Node(const glm::vec3 &min, const glm::vec3 &max,
+             Node *parent = nullptr)
+            : min(min), max(max), parent(parent) {}
         template <typename Ty>
         inline void Insert(const glm::vec3 &pos, Ty &&vertDat) {
-            if (datCap == 0) {
-                datCap = DEFAULT_DAT_CAP;
-                dat = new std::pair<glm::vec3, VertDatTy>[datCap];
-            } else if (datNum == datCap) {
-                datCap = datCap << 1;
-                auto *newPtr = new std::pair<glm::vec3, VertDatTy>[datCap];
-                memcpy(newPtr, dat,
-                       sizeof(std::pair<glm::vec3, VertDatTy>) * datNum);
-                delete[] dat;
-                dat = newPtr;
-            }
+            assert(datNum < LeafCap);
             dat[datNum].first = pos;
             dat[datNum++].second = std::forward<Ty>(vertDat);
         }
-        inline void Clear() {
-            if (datCap != 0) {
-                delete[] dat;
-                datNum = datCap = 0;
-            }
+        inline void Erase(uint8_t datIdx) {
+            assert(datIdx < datNum);
+            if (datIdx != --datNum)
+                dat[datIdx] = std::move(dat[datNum]);
+        }
+        inline void Clear() { datNum = 0; }
+    };
+    /// <summary>
+    /// Structure and memory statistics of a tree, see GetStats().
+    /// Payload is the inline dat array which every node allocates,
+    /// while only leaves use it.
+    /// </summary>
+    struct Stats {
+        size_t nodeNum = 0, leafNum = 0, datNum = 0;
+        size_t nodeBytes = 0, allocPayloadBytes = 0, usedPayloadBytes = 0;
+        size_t childSlotNum = 0, emptyChildNum = 0;
+        /// <summary>
+        /// Indexed by depth, root at 0
+        /// </summary>
+        std::vector<size_t> nodeDepthHist, leafDepthHist;
+        /// <summary>
+        /// leafFillHist[n] is the number of leaves holding n points
+        /// </summary>
+        std::array<size_t, LeafCap + 1> leafFillHist{0};
+        /// <summary>
+        /// emptyChildHist[n] is the number of non-leaf nodes having n
+        /// empty children
+        /// </summary>
+        std::array<size_t, 8> emptyChildHist{0};
+
+        friend std::ostream &operator<<(std::ostream &os, const Stats &stats) {
+            auto ratio = [](size_t num, size_t den) {
+                return den == 0 ? 0. : 100. * num / den;
+            };
+            os << "nodes " << stats.nodeNum << ", leaves " << stats.leafNum
+               << ", points " << stats.datNum << ", depth "
+               << stats.nodeDepthHist.size() << '\n';
+            os << "node bytes " << stats.nodeBytes << ", payload bytes "
+               << stats.usedPayloadBytes << '/' << stats.allocPayloadBytes
+               << " used (" << ratio(stats.usedPayloadBytes,
+                                     stats.allocPayloadBytes)
+               << "%)\n";
+            os << "empty children " << stats.emptyChildNum << '/'
+               << stats.childSlotNum << " ("
+               << ratio(stats.emptyChildNum, stats.childSlotNum) << "%)\n";
+            os << "depth [nodes/leaves]:";
+            for (size_t dep = 0; dep < stats.nodeDepthHist.size(); ++dep)
+                os << ' ' << dep << ':' << stats.nodeDepthHist[dep] << '/'
+                   << stats.leafDepthHist[dep];
+            os << "\nleaf fill [points:leaves]:";
+            for (size_t num = 0; num <= LeafCap; ++num)
+                if (stats.leafFillHist[num] != 0)
+                    os << ' ' << num << ':' << stats.leafFillHist[num];
+            os << "\nempty children per non-leaf [children:nodes]:";
+            for (size_t num = 0; num < 8; ++num)
+                if (stats.emptyChildHist[num] != 0)
+                    os << ' ' << num << ':' << stats.emptyChildHist[num];
+            return os;
         }
     };
 
   private:
-    using NodeTy = Node<VertDatTy>;
-    uint8_t maxDatNum = 8;
+    using NodeTy = Node;
     bool rootIsLeaf = true;
     NodeTy root;
 
   public:
+    static constexpr uint8_t LEAF_CAP = LeafCap;
+
+    PointOctree(const glm::vec3 &min, const glm::vec3 &max) : root(min, max) {}
+    /// <summary>
+    /// Bulk build top-down by partitioning dat in place, which avoids
+    /// descending from root and splitting leaves for every point.
+    /// As Insert(), points out of bound are dropped, and so are points
+    /// within maxSqrErr of a kept one in the same leaf.
+    /// </summary>
     PointOctree(const glm::vec3 &min, const glm::vec3 &max,
-                uint8_t maxDatNum = 8)
-        : root(min, max), maxDatNum(maxDatNum) {
-        assert(maxDatNum > 1);
+                std::vector<std::pair<glm::vec3, VertDatTy>> dat,
+                float maxSqrErr = std::numeric_limits<float>::epsilon())
+        : root(min, max) {
+        auto end = std::remove_if(dat.begin(), dat.end(), [&](const auto &d) {
+            return isOutOfBound(d.first);
+        });
+        buildFrom(&root, dat.begin(), end, maxSqrErr);
     }
+    PointOctree(const PointOctree &) = delete;
+    PointOctree &operator=(const PointOctree &) = delete;
     ~PointOctree() {
         std::stack<std::pair<NodeTy *, uint8_t>> stk;
         stk.emplace(&root, 0);
@@ -93,6 +164,48 @@ template <typename VertDatTy> class PointOctree {
             ++idx;
         }
     }
+    inline const NodeTy &GetRoot() const { return root; }
+    /// <summary>
+    /// Traverse the whole tree to collect Stats. Costs O(nodeNum).
+    /// </summary>
+    Stats GetStats() const {
+        Stats stats;
+        std::stack<std::pair<const NodeTy *, size_t>> stk;
+        stk.emplace(&root, 0);
+        while (!stk.empty()) {
+            auto [curr, dep] = stk.top();
+            stk.pop();
+            if (stats.nodeDepthHist.size() <= dep) {
+                stats.nodeDepthHist.resize(dep + 1, 0);
+                stats.leafDepthHist.resize(dep + 1, 0);
+            }
+            ++stats.nodeNum;
+            ++stats.nodeDepthHist[dep];
+            if (curr->datNum != 0 || (curr == &root && rootIsLeaf)) {
+                ++stats.leafNum;
+                ++stats.leafDepthHist[dep];
+                ++stats.leafFillHist[curr->datNum];
+                stats.datNum += curr->datNum;
+                continue;
+            }
+            uint8_t emptyChildNum = 0;
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                if (curr->children[chIdx])
+                    stk.emplace(curr->children[chIdx], dep + 1);
+                else
+                    ++emptyChildNum;
+            stats.childSlotNum += 8;
+            stats.emptyChildNum += emptyChildNum;
+            ++stats.emptyChildHist[emptyChildNum];
+        }
+        stats.nodeBytes = sizeof(NodeTy) * stats.nodeNum;
+        stats.allocPayloadBytes =
+            sizeof(typename decltype(NodeTy::dat)::value_type) * LeafCap *
+            stats.nodeNum;
+        stats.usedPayloadBytes =
+            sizeof(typename decltype(NodeTy::dat)::value_type) * stats.datNum;
+        return stats;
+    }
     std::pair<const NodeTy *, uint8_t>
     Query(const glm::vec3 &pos,
           float maxSqrErr = std::numeric_limits<float>::epsilon()) const {
@@ -103,8 +216,8 @@ template <typename VertDatTy> class PointOctree {
             if (curr->datNum != 0) {
                 // leaf node
                 float minSqrErr = std::numeric_limits<float>::max();
-                uint8_t minSqrErrIdx = 9;
-                for (uint8_t datIdx = 0; datIdx < maxDatNum; ++datIdx) {
+                uint8_t minSqrErrIdx = LeafCap;
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
                     float sqrErr = 0;
                     for (uint8_t xyz = 0; xyz < 3; ++xyz)
                         sqrErr += (curr->dat[datIdx].first[xyz] - pos[xyz]) *
@@ -114,7 +227,7 @@ template <typename VertDatTy> class PointOctree {
                         minSqrErrIdx = datIdx;
                     }
                 }
-                if (minSqrErrIdx == 9)
+                if (minSqrErrIdx == LeafCap)
                     return {nullptr, 0};
                 return {curr, minSqrErrIdx};
             }
@@ -123,9 +236,15 @@ template <typename VertDatTy> class PointOctree {
         }
         return {nullptr, 0};
     }
-    std::vector<const NodeTy *> Query(const Frustum &frustum) {
+    std::pair<NodeTy *, uint8_t>
+    Query(const glm::vec3 &pos,
+          float maxSqrErr = std::numeric_limits<float>::epsilon()) {
+        auto [node, datIdx] = std::as_const(*this).Query(pos, maxSqrErr);
+        return {const_cast<NodeTy *>(node), datIdx};
+    }
+    std::vector<const NodeTy *> Query(const Frustum &frustum) const {
         std::vector<const NodeTy *> ret;
-        std::stack<NodeTy *> stk;
+        std::stack<const NodeTy *> stk;
         stk.emplace(&root);
         while (!stk.empty()) {
             auto curr = stk.top();
@@ -141,6 +260,189 @@ template <typename VertDatTy> class PointOctree {
         }
         return ret;
     }
+    /// <summary>
+    /// Append data of points inside frustum to ret.
+    /// Faces which a node lies totally inside are not tested again
+    /// in its subtree, and a subtree lying totally inside the frustum
+    /// is appended without any test.
+    /// </summary>
+    void QueryDat(const Frustum &frustum, std::vector<VertDatTy> &ret) const {
+        std::stack<std::pair<const NodeTy *, uint8_t>> stk;
+        stk.emplace(&root, Frustum::ALL_FACES_MASK);
+        while (!stk.empty()) {
+            auto [curr, planeMask] = stk.top();
+            stk.pop();
+            if (planeMask != 0 &&
+                !frustum.IsIntersectedWithAABB(curr->min, curr->max,
+                                               planeMask))
+                continue;
+            if (planeMask == 0) {
+                appendSubtreeDat(curr, ret);
+                continue;
+            }
+            if (curr->datNum == 0) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    if (curr->children[chIdx])
+                        stk.emplace(curr->children[chIdx], planeMask);
+            } else
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx)
+                    if (frustum.IsIntersetcedWith(curr->dat[datIdx].first,
+                                                  planeMask))
+                        ret.emplace_back(curr->dat[datIdx].second);
+        }
+    }
+    std::vector<VertDatTy> QueryDat(const Frustum &frustum) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(frustum, ret);
+        return ret;
+    }
+    /// <summary>
+    /// Append data of points inside AABB [min, max] to ret.
+    /// A subtree lying totally inside AABB is appended without any test.
+    /// </summary>
+    void QueryDat(const glm::vec3 &min, const glm::vec3 &max,
+                  std::vector<VertDatTy> &ret) const {
+        std::stack<const NodeTy *> stk;
+        stk.emplace(&root);
+        while (!stk.empty()) {
+            auto curr = stk.top();
+            stk.pop();
+            bool isInside = true;
+            bool isOutside = false;
+            for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                if (curr->max[xyz] < min[xyz] || curr->min[xyz] > max[xyz]) {
+                    isOutside = true;
+                    break;
+                }
+                if (curr->min[xyz] < min[xyz] || curr->max[xyz] > max[xyz])
+                    isInside = false;
+            }
+            if (isOutside)
+                continue;
+            if (isInside) {
+                appendSubtreeDat(curr, ret);
+                continue;
+            }
+            if (curr->datNum == 0) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    if (curr->children[chIdx])
+                        stk.emplace(curr->children[chIdx]);
+            } else
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
+                    auto &pos = curr->dat[datIdx].first;
+                    if (pos.x >= min.x && pos.y >= min.y && pos.z >= min.z &&
+                        pos.x <= max.x && pos.y <= max.y && pos.z <= max.z)
+                        ret.emplace_back(curr->dat[datIdx].second);
+                }
+        }
+    }
+    std::vector<VertDatTy> QueryDat(const glm::vec3 &min,
+                                    const glm::vec3 &max) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(min, max, ret);
+        return ret;
+    }
+    /// <summary>
+    /// Append data of points inside sphere (cntr, radius) to ret.
+    /// A subtree lying totally inside sphere is appended without any test.
+    /// </summary>
+    void QueryDat(const glm::vec3 &cntr, float radius,
+                  std::vector<VertDatTy> &ret) const {
+        auto sqrRadius = radius * radius;
+        std::stack<const NodeTy *> stk;
+        stk.emplace(&root);
+        while (!stk.empty()) {
+            auto curr = stk.top();
+            stk.pop();
+            float sqrNear = 0, sqrFar = 0;
+            for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+                auto dNear = std::max({curr->min[xyz] - cntr[xyz], 0.f,
+                                       cntr[xyz] - curr->max[xyz]});
+                auto dFar = std::max(cntr[xyz] - curr->min[xyz],
+                                     curr->max[xyz] - cntr[xyz]);
+                sqrNear += dNear * dNear;
+                sqrFar += dFar * dFar;
+            }
+            if (sqrNear > sqrRadius)
+                continue;
+            if (sqrFar <= sqrRadius) {
+                appendSubtreeDat(curr, ret);
+                continue;
+            }
+            if (curr->datNum == 0) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    if (curr->children[chIdx])
+                        stk.emplace(curr->children[chIdx]);
+            } else
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
+                    auto dlt = curr->dat[datIdx].first - cntr;
+                    if (glm::dot(dlt, dlt) <= sqrRadius)
+                        ret.emplace_back(curr->dat[datIdx].second);
+                }
+        }
+    }
+    std::vector<VertDatTy> QueryDat(const glm::vec3 &cntr,
+                                    float radius) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(cntr, radius, ret);
+        return ret;
+    }
+    /// <summary>
+    /// Return the leaf and index of the point whose sphere of radius is
+    /// first hit by the ray, and the distance from org to the hit.
+    /// drc should be normalized. An org inside a sphere hits it at 0.
+    /// Nodes are visited front-to-back with their AABBs expanded by radius,
+    /// and those entered behind the nearest hit so far are pruned.
+    /// </summary>
+    std::tuple<const NodeTy *, uint8_t, float>
+    QueryRay(const glm::vec3 &org, const glm::vec3 &drc, float radius) const {
+        const NodeTy *hitNode = nullptr;
+        uint8_t hitIdx = 0;
+        float hitT = std::numeric_limits<float>::infinity();
+
+        using Entry = std::pair<float, const NodeTy *>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> que;
+        if (auto tEnter = intersectRayWithAABB(org, drc, root.min - radius,
+                                               root.max + radius);
+            tEnter != std::numeric_limits<float>::infinity())
+            que.emplace(tEnter, &root);
+        auto sqrRadius = radius * radius;
+        while (!que.empty()) {
+            auto [tEnter, curr] = que.top();
+            que.pop();
+            if (tEnter >= hitT)
+                break;
+            if (curr->datNum != 0) {
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
+                    auto v = curr->dat[datIdx].first - org;
+                    auto tCntr = glm::dot(v, drc);
+                    auto sqrDist = glm::dot(v, v) - tCntr * tCntr;
+                    if (sqrDist > sqrRadius)
+                        continue;
+                    auto tHalf = sqrtf(sqrRadius - sqrDist);
+                    if (tCntr + tHalf < 0)
+                        continue;
+                    auto t = std::max(tCntr - tHalf, 0.f);
+                    if (t < hitT) {
+                        hitT = t;
+                        hitNode = curr;
+                        hitIdx = datIdx;
+                    }
+                }
+                continue;
+            }
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+                auto child = curr->children[chIdx];
+                if (!child)
+                    continue;
+                auto tChEnter = intersectRayWithAABB(
+                    org, drc, child->min - radius, child->max + radius);
+                if (tChEnter < hitT)
+                    que.emplace(tChEnter, child);
+            }
+        }
+        return {hitNode, hitIdx, hitT};
+    }
     template <typename Ty>
     void Insert(const glm::vec3 &pos, Ty &&vertDat,
                 float maxSqrErr = std::numeric_limits<float>::epsilon()) {
@@ -148,49 +450,142 @@ template <typename VertDatTy> class PointOctree {
             return;
         if (Query(pos, maxSqrErr).first)
             return; // duplicate
-        if (rootIsLeaf)
-            if (root.datNum == maxDatNum)
+        insertFrom(&root, pos, std::forward<Ty>(vertDat));
+    }
+    /// <summary>
+    /// Remove the point nearest to pos within maxSqrErr.
+    /// Subtrees left underfull are collapsed back into a single leaf.
+    /// Return false if no such point exists.
+    /// </summary>
+    bool Remove(const glm::vec3 &pos,
+                float maxSqrErr = std::numeric_limits<float>::epsilon()) {
+        auto [leaf, datIdx] = Query(pos, maxSqrErr);
+        if (!leaf)
+            return false;
+        leaf->Erase(datIdx);
+        collapseFrom(leaf);
+        return true;
+    }
+    /// <summary>
+    /// Move the point nearest to oldPos within maxSqrErr to newPos.
+    /// A point staying in its leaf is updated in place, otherwise it is
+    /// re-binned from the lowest ancestor containing newPos.
+    /// The point is removed if newPos is out of bound, or if another point
+    /// lies within maxSqrErr of newPos, as Insert() drops duplicates.
+    /// Otherwise coincident points could fill a leaf which never splits.
+    /// Return false if no point is found or it has been removed.
+    /// </summary>
+    bool Update(const glm::vec3 &oldPos, const glm::vec3 &newPos,
+                float maxSqrErr = std::numeric_limits<float>::epsilon()) {
+        auto [leaf, datIdx] = Query(oldPos, maxSqrErr);
+        if (!leaf)
+            return false;
+        auto [dupLeaf, dupIdx] = Query(newPos, maxSqrErr);
+        if (isOutOfBound(newPos) ||
+            (dupLeaf && (dupLeaf != leaf || dupIdx != datIdx))) {
+            leaf->Erase(datIdx);
+            collapseFrom(leaf);
+            return false;
+        }
+        if (isInNode(leaf, newPos)) {
+            leaf->dat[datIdx].first = newPos;
+            return true;
+        }
+
+        auto vertDat = std::move(leaf->dat[datIdx].second);
+        leaf->Erase(datIdx);
+        auto curr = collapseFrom(leaf);
+        while (curr != &root && !isInNode(curr, newPos))
+            curr = curr->parent;
+        insertFrom(curr, newPos, std::move(vertDat));
+        return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os,
+                                    const PointOctree &tree) {
+        std::queue<std::pair<decltype(&tree.root), uint8_t>> que;
+        que.emplace(&tree.root, (uint8_t)0);
+        size_t count = 0, currLayerNum = 1, currLayerAcc = 1;
+        while (!que.empty()) {
+            auto curr = que.front();
+            que.pop();
+            if (!curr.first)
+                os << " |_" << (uint32_t)curr.second << "_| ";
+            else if (curr.first->datNum != 0) {
+                os << "|<" << (uint32_t)curr.second << ">("
+                   << curr.first->dat[0].first.x << ','
+                   << curr.first->dat[0].first.y << ','
+                   << curr.first->dat[0].first.z
+                   << "):" << curr.first->dat[0].second;
+                for (uint8_t datIdx = 1; datIdx < curr.first->datNum; ++datIdx)
+                    os << "; " << '(' << curr.first->dat[datIdx].first.x << ','
+                       << curr.first->dat[datIdx].first.y << ','
+                       << curr.first->dat[datIdx].first.z
+                       << "):" << curr.first->dat[datIdx].second;
+                os << "| ";
+            } else {
+                os << " |[" << (uint32_t)curr.second << "]| ";
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    que.emplace(curr.first->children[chIdx], chIdx);
+            }
+            if (curr.second == 7)
+                os << " == ";
+
+            ++count;
+            if (count == currLayerAcc) {
+                os << std::endl;
+                currLayerNum <<= 3;
+                currLayerAcc += currLayerNum;
+            }
+        }
+        return os;
+    }
+
+  private:
+    template <typename Ty>
+    void insertFrom(NodeTy *curr, const glm::vec3 &pos, Ty &&vertDat) {
+        if (curr == &root && rootIsLeaf)
+            if (root.datNum == LeafCap)
                 rootIsLeaf = false;
             // then split root at successed procedure
             else {
                 root.Insert(pos, std::forward<Ty>(vertDat));
                 return;
             }
-        NodeTy *curr = &root;
         while (true) {
             if (curr->datNum != 0) {
                 // leaf node
-                if (curr->datNum == maxDatNum) {
+                if (curr->datNum == LeafCap) {
                     // spilit
                     NodeTy *oldNode = curr;
                     glm::vec3 mid;
                     while (true) {
                         mid = (curr->min + curr->max) * .5f;
                         uint8_t prevChIdx =
-                            getChildIdx(mid, curr->dat[0].first);
+                            getChildIdx(mid, oldNode->dat[0].first);
                         uint8_t datIdx = 1;
-                        for (; datIdx < maxDatNum; ++datIdx) {
+                        for (; datIdx < LeafCap; ++datIdx) {
                             auto chIdx =
                                 getChildIdx(mid, oldNode->dat[datIdx].first);
                             if (chIdx != prevChIdx)
                                 break;
                         }
-                        if (datIdx != maxDatNum)
+                        if (datIdx != LeafCap ||
+                            getChildIdx(mid, pos) != prevChIdx)
                             break; // can be spilited at current layer
                         // else insert a new layer
                         auto [min, max] = getChildMinAndMax(
                             curr->min, curr->max, mid, prevChIdx);
-                        curr->children[prevChIdx] = new NodeTy(min, max);
+                        curr->children[prevChIdx] = new NodeTy(min, max, curr);
                         curr = curr->children[prevChIdx];
                     }
                     mid = (curr->min + curr->max) * .5f;
-                    for (uint8_t datIdx = 0; datIdx < maxDatNum; ++datIdx) {
+                    for (uint8_t datIdx = 0; datIdx < LeafCap; ++datIdx) {
                         auto chIdx =
                             getChildIdx(mid, oldNode->dat[datIdx].first);
                         if (!curr->children[chIdx]) {
                             auto [min, max] = getChildMinAndMax(
                                 curr->min, curr->max, mid, chIdx);
-                            curr->children[chIdx] = new NodeTy(min, max);
+                            curr->children[chIdx] = new NodeTy(min, max, curr);
                         }
                         curr->children[chIdx]->Insert(
                             oldNode->dat[datIdx].first,
@@ -201,7 +596,7 @@ template <typename VertDatTy> class PointOctree {
                     if (!curr->children[chIdx]) {
                         auto [min, max] =
                             getChildMinAndMax(curr->min, curr->max, mid, chIdx);
-                        curr->children[chIdx] = new NodeTy(min, max);
+                        curr->children[chIdx] = new NodeTy(min, max, curr);
                     }
                     curr->children[chIdx]->Insert(pos,
                                                   std::forward<Ty>(vertDat));
@@ -215,61 +610,177 @@ template <typename VertDatTy> class PointOctree {
                 if (!curr->children[chIdx]) {
                     auto [min, max] =
                         getChildMinAndMax(curr->min, curr->max, mid, chIdx);
-                    curr->children[chIdx] = new NodeTy(min, max);
-                    curr->children[chIdx]->Insert(pos, vertDat);
+                    curr->children[chIdx] = new NodeTy(min, max, curr);
+                    curr->children[chIdx]->Insert(pos,
+                                                  std::forward<Ty>(vertDat));
                     return;
                 }
                 curr = curr->children[chIdx];
             }
         }
     }
-    friend std::ostream &operator<<(std::ostream &os,
-                                    const PointOctree<VertDatTy> &tree) {
-        std::queue<std::pair<decltype(&tree.root), uint8_t>> que;
-        que.emplace(&tree.root, (uint8_t)0);
-        size_t count = 0, currLayerNum = 1, currLayerAcc = 1;
-        while (!que.empty()) {
-            auto curr = que.front();
-            que.pop();
-            if (!curr.first)
-                os << " |_" << (uint32_t)curr.second << "_| ";
-            else if (curr.first->datNum != 0) {
-                os << "|<" << (uint32_t)curr.second << ">("
-                   << curr.first->dat[0].first.x << ','
-                   << curr.first->dat[0].first.y << ','
-                   << curr.first->dat[0].first.z
-                   << "):" << curr.first->dat[0].second;
-                for (uint8_t datIdx = 1; datIdx < curr.first->datNum; ++datIdx)
-                    os << "; " << '(' << curr.first->dat[datIdx].first.x << ','
-                       << curr.first->dat[datIdx].first.y << ','
-                       << curr.first->dat[datIdx].first.z
-                       << "):" << curr.first->dat[datIdx].second;
-                os << "| ";
-            } else {
-                os << " |[" << (uint32_t)curr.second << "]| ";
-                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
-                    que.emplace(curr.first->children[chIdx], chIdx);
+    using DatItr =
+        typename std::vector<std::pair<glm::vec3, VertDatTy>>::iterator;
+    void buildFrom(NodeTy *curr, DatItr beg, DatItr end, float maxSqrErr) {
+        auto toLeaf = [&](DatItr beg, DatItr end) {
+            for (auto itr = beg; itr != end && curr->datNum < LeafCap;
+                 ++itr) {
+                bool isDup = false;
+                for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
+                    auto dlt = curr->dat[datIdx].first - itr->first;
+                    if (glm::dot(dlt, dlt) <= maxSqrErr) {
+                        isDup = true;
+                        break;
+                    }
+                }
+                if (!isDup)
+                    curr->Insert(itr->first, std::move(itr->second));
             }
-            if (curr.second == 7)
-                os << " == ";
+        };
+        if (end - beg <= LeafCap) {
+            toLeaf(beg, end);
+            return;
+        }
+        // points which can not be separated are duplicates of the first
+        auto dlt = curr->max - curr->min;
+        if (glm::dot(dlt, dlt) <= maxSqrErr ||
+            std::all_of(beg + 1, end, [&](const auto &d) {
+                return d.first == beg->first;
+            })) {
+            toLeaf(beg, beg + 1);
+            return;
+        }
 
-            ++count;
-            if (count == currLayerAcc) {
-                os << std::endl;
-                currLayerNum <<= 3;
-                currLayerAcc += currLayerNum;
-            }
+        if (curr == &root)
+            rootIsLeaf = false;
+        auto mid = (curr->min + curr->max) * .5f;
+        // ranges[chIdx] to ranges[chIdx + 1] falls in child chIdx
+        std::array<DatItr, 9> ranges;
+        ranges[0] = beg;
+        ranges[8] = end;
+        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+            uint8_t step = 0x1 << (3 - xyz);
+            for (uint8_t chIdx = 0; chIdx < 8; chIdx += step)
+                ranges[chIdx + step / 2] = std::partition(
+                    ranges[chIdx], ranges[chIdx + step],
+                    [&](const auto &d) { return d.first[xyz] < mid[xyz]; });
+        }
+        for (uint8_t chIdx = 0; chIdx < 8; ++chIdx) {
+            if (ranges[chIdx] == ranges[chIdx + 1])
+                continue;
+            auto [chMin, chMax] =
+                getChildMinAndMax(curr->min, curr->max, mid, chIdx);
+            curr->children[chIdx] = new NodeTy(chMin, chMax, curr);
+            buildFrom(curr->children[chIdx], ranges[chIdx], ranges[chIdx + 1],
+                      maxSqrErr);
         }
-        return os;
     }
+    static void appendSubtreeDat(const NodeTy *node,
+                                 std::vector<VertDatTy> &ret) {
+        std::stack<const NodeTy *> stk;
+        stk.emplace(node);
+        while (!stk.empty()) {
+            auto curr = stk.top();
+            stk.pop();
+            for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx)
+                ret.emplace_back(curr->dat[datIdx].second);
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                if (curr->children[chIdx])
+                    stk.emplace(curr->children[chIdx]);
+        }
+    }
+    /// <summary>
+    /// Called after a point is erased from leaf. Drop leaf if it is empty,
+    /// then merge ancestors whose children are all leaves holding no more
+    /// than half of LeafCap points in total.
+    /// Return the lowest node on the path which still exists.
+    /// </summary>
+    NodeTy *collapseFrom(NodeTy *leaf) {
+        if (leaf == &root)
+            return &root;
+        NodeTy *curr = leaf->parent;
+        if (leaf->datNum == 0) {
+            curr->children[getChildIdxOf(curr, leaf)] = nullptr;
+            delete leaf;
+        }
+        while (true) {
+            uint32_t sum = 0;
+            for (auto child : curr->children)
+                if (child) {
+                    if (child->datNum == 0)
+                        return curr; // non-leaf child
+                    sum += child->datNum;
+                }
+            if (sum > LeafCap / 2)
+                return curr;
 
-  private:
+            for (auto &child : curr->children)
+                if (child) {
+                    for (uint8_t datIdx = 0; datIdx < child->datNum; ++datIdx)
+                        curr->Insert(child->dat[datIdx].first,
+                                     std::move(child->dat[datIdx].second));
+                    delete child;
+                    child = nullptr;
+                }
+            if (curr == &root) {
+                rootIsLeaf = true;
+                return &root;
+            }
+            if (curr->datNum != 0)
+                return curr;
+
+            // curr is left with neither points nor children
+            NodeTy *par = curr->parent;
+            par->children[getChildIdxOf(par, curr)] = nullptr;
+            delete curr;
+            curr = par;
+        }
+    }
+    /// <summary>
+    /// Slab test. Return the distance at which the ray enters AABB,
+    /// 0 if org is inside, or infinity if it misses.
+    /// </summary>
+    static inline float intersectRayWithAABB(const glm::vec3 &org,
+                                             const glm::vec3 &drc,
+                                             const glm::vec3 &min,
+                                             const glm::vec3 &max) {
+        float tEnter = 0, tExit = std::numeric_limits<float>::infinity();
+        for (uint8_t xyz = 0; xyz < 3; ++xyz) {
+            if (drc[xyz] == 0) {
+                if (org[xyz] < min[xyz] || org[xyz] > max[xyz])
+                    return std::numeric_limits<float>::infinity();
+                continue;
+            }
+            auto invD = 1.f / drc[xyz];
+            auto t0 = (min[xyz] - org[xyz]) * invD;
+            auto t1 = (max[xyz] - org[xyz]) * invD;
+            if (t0 > t1)
+                std::swap(t0, t1);
+            tEnter = std::max(tEnter, t0);
+            tExit = std::min(tExit, t1);
+            if (tEnter > tExit)
+                return std::numeric_limits<float>::infinity();
+        }
+        return tEnter;
+    }
     inline bool isOutOfBound(const glm::vec3 &pos) const {
         for (uint8_t xyz = 0; xyz < 3; ++xyz)
-            if (pos[xyz] < root.min[xyz] && pos[xyz] >= root.max[xyz])
+            if (pos[xyz] < root.min[xyz] || pos[xyz] > root.max[xyz])
                 return true;
         return false;
     }
+    /// <summary>
+    /// Consistent with getChildIdx(), a node holds [min, max)
+    /// except that the root holds [min, max].
+    /// </summary>
+    inline bool isInNode(const NodeTy *node, const glm::vec3 &pos) const {
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            if (pos[xyz] < node->min[xyz] ||
+                (pos[xyz] >= node->max[xyz] &&
+                 node->max[xyz] != root.max[xyz]))
+                return false;
+        return true;
+    }
     static inline uint8_t getChildIdx(const glm::vec3 &mid,
                                       const glm::vec3 &pos) {
         uint8_t idx = 0;
@@ -280,6 +791,11 @@ template <typename VertDatTy> class PointOctree {
                 idx |= (0x1 << (2 - xyz));
         return idx;
     }
+    static inline uint8_t getChildIdxOf(const NodeTy *par,
+                                        const NodeTy *child) {
+        return getChildIdx((par->min + par->max) * .5f,
+                           (child->min + child->max) * .5f);
+    }
     static inline std::pair<glm::vec3, glm::vec3>
     getChildMinAndMax(const glm::vec3 &min, const glm::vec3 &max,
                       const glm::vec3 &mid, uint8_t chIdx) {
@@ -295,5 +811,10 @@ template <typename VertDatTy> class PointOctree {
         return ret;
     }
 };
+
+template <typename VertDatTy> using PointOctree4 = PointOctree<VertDatTy, 4>;
+template <typename VertDatTy> using PointOctree8 = PointOctree<VertDatTy, 8>;
+template <typename VertDatTy>
+using PointOctree16 = PointOctree<VertDatTy, 16>;
 } // namespace kouek
 #endif // !KOUEK_POINT_OCTREE_H
@@ -0,0 +1,268 @@
+#ifndef KOUEK_POINT_OCTREE_SNAPSHOT_H
+#define KOUEK_POINT_OCTREE_SNAPSHOT_H
+
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <util/mapped_file.hpp>
+#include <util/point_octree.hpp>
+
+namespace kouek {
+/// <summary>
+/// Read-only PointOctree which runs queries directly on
+/// a memory-mapped snapshot file. Snapshot file is managed in format:
+/// [Header][FlatNode * nodeNum][VertDatTy * datNum][padding]
+/// [glm::vec3 * datNum]
+/// where padding aligns positions to alignof(glm::vec3), and the offset of
+/// positions is recorded in Header::possOffs.
+/// Nodes are stored in BFS order, thus children of a node are contiguous
+/// and located by a relative offset plus a child mask.
+/// </summary>
+template <typename VertDatTy> class PointOctreeSnapshot {
+    static_assert(std::is_trivially_copyable_v<VertDatTy>,
+                  "VertDatTy of PointOctreeSnapshot should be trivially "
+                  "copyable");
+    static_assert(alignof(VertDatTy) <= 8,
+                  "VertDatTy of PointOctreeSnapshot should be aligned to "
+                  "no more than 8 bytes");
+
+  public:
+    static constexpr uint32_t VERSION = 2;
+    static constexpr char MAGIC[8] = {'K', 'O', 'U', 'E', 'K', 'P', 'O', 'T'};
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t datSize;
+        uint32_t nodeNum;
+        uint32_t datNum;
+        /// <summary>
+        /// Offset in bytes of positions from the beginning of the file
+        /// </summary>
+        uint64_t possOffs;
+        glm::vec3 min, max;
+    };
+    struct FlatNode {
+        glm::vec3 min, max;
+        /// <summary>
+        /// Index of the first child minus index of this node,
+        /// valid only when childMask != 0
+        /// </summary>
+        uint32_t firstChildOffs;
+        uint32_t datStart;
+        uint8_t datNum;
+        /// <summary>
+        /// Bit i is set if child i exists
+        /// </summary>
+        uint8_t childMask;
+        uint8_t padding[6];
+    };
+    static_assert(sizeof(Header) % 8 == 0 && sizeof(FlatNode) % 8 == 0,
+                  "Header and FlatNode should keep the data block aligned");
+
+  private:
+    MappedFile file;
+    const Header *header = nullptr;
+    const FlatNode *nodes = nullptr;
+    const glm::vec3 *poss = nullptr;
+    const VertDatTy *dats = nullptr;
+
+  public:
+    PointOctreeSnapshot(const std::string &filePath) : file(filePath) {
+        if (file.GetSize() < sizeof(Header))
+            throw std::runtime_error("Invalid snapshot file: " + filePath);
+        header = reinterpret_cast<const Header *>(file.GetData());
+        if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header->version != VERSION ||
+            header->datSize != sizeof(VertDatTy) ||
+            header->possOffs !=
+                getPossOffs(header->nodeNum, header->datNum) ||
+            file.GetSize() !=
+                header->possOffs + sizeof(glm::vec3) * header->datNum)
+            throw std::runtime_error("Invalid snapshot file: " + filePath);
+        nodes = reinterpret_cast<const FlatNode *>(file.GetData() +
+                                                   sizeof(Header));
+        dats = reinterpret_cast<const VertDatTy *>(nodes + header->nodeNum);
+        poss = reinterpret_cast<const glm::vec3 *>(file.GetData() +
+                                                   header->possOffs);
+    }
+    PointOctreeSnapshot(const PointOctreeSnapshot &) = delete;
+    PointOctreeSnapshot &operator=(const PointOctreeSnapshot &) = delete;
+
+    template <uint8_t LeafCap>
+    static void Write(const PointOctree<VertDatTy, LeafCap> &tree,
+                      const std::string &filePath) {
+        using NodeTy = typename PointOctree<VertDatTy, LeafCap>::Node;
+
+        std::vector<FlatNode> flatNodes;
+        std::vector<glm::vec3> flatPoss;
+        std::vector<VertDatTy> flatDats;
+        std::queue<const NodeTy *> que;
+        que.emplace(&tree.GetRoot());
+        uint32_t enqueuedNum = 1;
+        while (!que.empty()) {
+            auto curr = que.front();
+            que.pop();
+            auto &flatNode = flatNodes.emplace_back();
+            flatNode.min = curr->min;
+            flatNode.max = curr->max;
+            flatNode.firstChildOffs =
+                enqueuedNum - static_cast<uint32_t>(flatNodes.size() - 1);
+            flatNode.datStart = static_cast<uint32_t>(flatDats.size());
+            flatNode.datNum = curr->datNum;
+            flatNode.childMask = 0;
+            memset(flatNode.padding, 0, sizeof(flatNode.padding));
+            for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx) {
+                flatPoss.emplace_back(curr->dat[datIdx].first);
+                flatDats.emplace_back(curr->dat[datIdx].second);
+            }
+            for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                if (curr->children[chIdx]) {
+                    flatNode.childMask |= 0x1 << chIdx;
+                    que.emplace(curr->children[chIdx]);
+                    ++enqueuedNum;
+                }
+        }
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.datSize = sizeof(VertDatTy);
+        header.nodeNum = static_cast<uint32_t>(flatNodes.size());
+        header.datNum = static_cast<uint32_t>(flatDats.size());
+        header.possOffs = getPossOffs(header.nodeNum, header.datNum);
+        header.min = tree.GetRoot().min;
+        header.max = tree.GetRoot().max;
+
+        std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("Cannot open file: " + filePath);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char *>(flatNodes.data()),
+                  sizeof(FlatNode) * flatNodes.size());
+        out.write(reinterpret_cast<const char *>(flatDats.data()),
+                  sizeof(VertDatTy) * flatDats.size());
+        char padding[alignof(glm::vec3)] = {0};
+        out.write(padding, header.possOffs - sizeof(Header) -
+                               sizeof(FlatNode) * flatNodes.size() -
+                               sizeof(VertDatTy) * flatDats.size());
+        out.write(reinterpret_cast<const char *>(flatPoss.data()),
+                  sizeof(glm::vec3) * flatPoss.size());
+        if (!out.good())
+            throw std::runtime_error("Cannot write file: " + filePath);
+    }
+
+    inline uint32_t GetNodeNum() const { return header->nodeNum; }
+    inline uint32_t GetDatNum() const { return header->datNum; }
+    /// <summary>
+    /// Same as PointOctree::Query(pos, maxSqrErr),
+    /// but return the data pointer instead of the leaf
+    /// </summary>
+    const VertDatTy *
+    Query(const glm::vec3 &pos,
+          float maxSqrErr = std::numeric_limits<float>::epsilon()) const {
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            if (pos[xyz] < header->min[xyz] || pos[xyz] > header->max[xyz])
+                return nullptr;
+        const FlatNode *curr = nodes;
+        while (true) {
+            if (curr->childMask == 0) {
+                // leaf node
+                float minSqrErr = std::numeric_limits<float>::max();
+                const VertDatTy *ret = nullptr;
+                for (uint32_t datIdx = curr->datStart;
+                     datIdx < curr->datStart + curr->datNum; ++datIdx) {
+                    auto dlt = poss[datIdx] - pos;
+                    float sqrErr = glm::dot(dlt, dlt);
+                    if (sqrErr <= maxSqrErr && sqrErr < minSqrErr) {
+                        minSqrErr = sqrErr;
+                        ret = &dats[datIdx];
+                    }
+                }
+                return ret;
+            }
+            auto chIdx = getChildIdx((curr->min + curr->max) * .5f, pos);
+            if ((curr->childMask & (0x1 << chIdx)) == 0)
+                return nullptr;
+            curr = getChild(curr, chIdx);
+        }
+    }
+    /// <summary>
+    /// Same as PointOctree::QueryDat(frustum, ret)
+    /// </summary>
+    void QueryDat(const Frustum &frustum, std::vector<VertDatTy> &ret) const {
+        std::stack<std::pair<const FlatNode *, uint8_t>> stk;
+        stk.emplace(nodes, Frustum::ALL_FACES_MASK);
+        while (!stk.empty()) {
+            auto [curr, planeMask] = stk.top();
+            stk.pop();
+            if (planeMask != 0 &&
+                !frustum.IsIntersectedWithAABB(curr->min, curr->max,
+                                               planeMask))
+                continue;
+            if (planeMask == 0) {
+                // totally inside, append the whole subtree
+                std::stack<const FlatNode *> subStk;
+                subStk.emplace(curr);
+                while (!subStk.empty()) {
+                    auto sub = subStk.top();
+                    subStk.pop();
+                    ret.insert(ret.end(), dats + sub->datStart,
+                               dats + sub->datStart + sub->datNum);
+                    for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                        if ((sub->childMask & (0x1 << chIdx)) != 0)
+                            subStk.emplace(getChild(sub, chIdx));
+                }
+                continue;
+            }
+            if (curr->childMask != 0) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    if ((curr->childMask & (0x1 << chIdx)) != 0)
+                        stk.emplace(getChild(curr, chIdx), planeMask);
+            } else
+                for (uint32_t datIdx = curr->datStart;
+                     datIdx < curr->datStart + curr->datNum; ++datIdx)
+                    if (frustum.IsIntersetcedWith(poss[datIdx], planeMask))
+                        ret.emplace_back(dats[datIdx]);
+        }
+    }
+    std::vector<VertDatTy> QueryDat(const Frustum &frustum) const {
+        std::vector<VertDatTy> ret;
+        QueryDat(frustum, ret);
+        return ret;
+    }
+
+  private:
+    static inline uint64_t getPossOffs(uint32_t nodeNum, uint32_t datNum) {
+        constexpr uint64_t ALIGN = alignof(glm::vec3);
+        uint64_t offs = sizeof(Header) + sizeof(FlatNode) * nodeNum +
+                        sizeof(VertDatTy) * datNum;
+        return (offs + ALIGN - 1) / ALIGN * ALIGN;
+    }
+    static inline uint8_t getChildIdx(const glm::vec3 &mid,
+                                      const glm::vec3 &pos) {
+        uint8_t idx = 0;
+        for (uint8_t xyz = 0; xyz < 3; ++xyz)
+            if (pos[xyz] >= mid[xyz])
+                idx |= (0x1 << (2 - xyz));
+        return idx;
+    }
+    static inline const FlatNode *getChild(const FlatNode *node,
+                                           uint8_t chIdx) {
+        // count existing children before chIdx
+        uint8_t lowerMask = node->childMask & ((0x1 << chIdx) - 1);
+        uint8_t rank = 0;
+        for (; lowerMask; lowerMask &= lowerMask - 1)
+            ++rank;
+        return node + node->firstChildOffs + rank;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_POINT_OCTREE_SNAPSHOT_H
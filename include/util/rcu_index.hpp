@@ -0,0 +1,150 @@
+#ifndef KOUEK_RCU_INDEX_H
+#define KOUEK_RCU_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kouek {
+/// <summary>
+/// Read-copy-update wrapper of an immutable index, e.g. PointOctree or
+/// HashGrid. Readers pin the current version with Pin(), which only claims
+/// a reader slot and loads a pointer, so queries never wait for a writer.
+/// A writer builds a new version aside and publishes it with Publish().
+/// Replaced versions are freed once no reader pinned before the publish
+/// is still holding them (epoch-based reclamation).
+/// A pinned version must be treated as read-only.
+/// </summary>
+template <typename IndexTy> class RCUIndex {
+  public:
+    static constexpr size_t READER_SLOT_NUM = 64;
+
+  private:
+    static constexpr uint64_t FREE_SLOT = std::numeric_limits<uint64_t>::max();
+
+    struct Retired {
+        uint64_t epoch;
+        const IndexTy *idx;
+    };
+
+    std::atomic<const IndexTy *> curr{nullptr};
+    std::atomic<uint64_t> epoch{0};
+    std::array<std::atomic<uint64_t>, READER_SLOT_NUM> slots;
+    /// <summary>
+    /// Only serializes writers, never taken by readers
+    /// </summary>
+    std::mutex writeMtx;
+    std::vector<Retired> retireds;
+
+  public:
+    /// <summary>
+    /// RAII handle of a pinned version. Falsy if nothing is published yet.
+    /// </summary>
+    class ReadGuard {
+      private:
+        std::atomic<uint64_t> *slot;
+        const IndexTy *idx;
+
+        ReadGuard(std::atomic<uint64_t> *slot, const IndexTy *idx)
+            : slot(slot), idx(idx) {}
+        friend class RCUIndex;
+
+      public:
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+        ReadGuard(ReadGuard &&other) noexcept
+            : slot(other.slot), idx(other.idx) {
+            other.slot = nullptr;
+        }
+        ~ReadGuard() {
+            if (slot)
+                slot->store(FREE_SLOT, std::memory_order_release);
+        }
+        inline const IndexTy *Get() const { return idx; }
+        inline const IndexTy *operator->() const { return idx; }
+        inline const IndexTy &operator*() const { return *idx; }
+        inline explicit operator bool() const { return idx != nullptr; }
+    };
+
+    RCUIndex() {
+        for (auto &slot : slots)
+            slot.store(FREE_SLOT, std::memory_order_relaxed);
+    }
+    RCUIndex(const RCUIndex &) = delete;
+    RCUIndex &operator=(const RCUIndex &) = delete;
+    /// <summary>
+    /// No reader should be alive
+    /// </summary>
+    ~RCUIndex() {
+        for (auto &retired : retireds)
+            delete retired.idx;
+        delete curr.load();
+    }
+    /// <summary>
+    /// Lock-free unless all READER_SLOT_NUM slots are claimed at once,
+    /// in which case it spins until one is released.
+    /// </summary>
+    ReadGuard Pin() {
+        while (true) {
+            for (auto &slot : slots) {
+                auto expected = FREE_SLOT;
+                if (slot.compare_exchange_strong(expected, epoch.load()))
+                    return ReadGuard(&slot, curr.load());
+            }
+            std::this_thread::yield();
+        }
+    }
+    /// <summary>
+    /// Make idx the current version, then free replaced versions which
+    /// are no longer pinned.
+    /// </summary>
+    void Publish(std::unique_ptr<IndexTy> idx) {
+        std::lock_guard lk(writeMtx);
+        auto old = curr.exchange(idx.release());
+        if (old)
+            retireds.push_back({epoch.fetch_add(1), old});
+        reclaim();
+    }
+    template <typename... ArgTys> void Emplace(ArgTys &&...args) {
+        Publish(std::make_unique<IndexTy>(std::forward<ArgTys>(args)...));
+    }
+    /// <summary>
+    /// Retry freeing replaced versions, e.g. when readers have released
+    /// them long after the last Publish()
+    /// </summary>
+    void Reclaim() {
+        std::lock_guard lk(writeMtx);
+        reclaim();
+    }
+    inline size_t GetRetiredNum() {
+        std::lock_guard lk(writeMtx);
+        return retireds.size();
+    }
+
+  private:
+    /// <summary>
+    /// A reader holding a version retired at epoch e has claimed its slot
+    /// with an epoch no greater than e, since it loaded the version before
+    /// the version was replaced
+    /// </summary>
+    void reclaim() {
+        auto minPinned = FREE_SLOT;
+        for (auto &slot : slots)
+            minPinned = std::min(minPinned, slot.load());
+        size_t kept = 0;
+        for (auto &retired : retireds)
+            if (retired.epoch < minPinned)
+                delete retired.idx;
+            else
+                retireds[kept++] = retired;
+        retireds.resize(kept);
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_RCU_INDEX_H
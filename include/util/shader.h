@@ -9,18 +9,25 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 class Shader {
   public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly.
+    // if binaryCacheDir is given, the linked program binary is cached there,
+    // keyed by the hash of sources and driver, and loaded on later launches
     // ------------------------------------------------------------------------
     Shader(const char *vertexPath, const char *fragmentPath,
-           const char *geometryPath = nullptr) {
+           const char *geometryPath = nullptr,
+           const char *binaryCacheDir = nullptr) {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -58,6 +65,12 @@ class Shader {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: "
                       << e.what() << std::endl;
         }
+        std::filesystem::path binaryPath;
+        if (binaryCacheDir != nullptr)
+            binaryPath = getBinaryPath(binaryCacheDir, vertexCode,
+                                       fragmentCode, geometryCode);
+        if (!binaryPath.empty() && loadBinary(binaryPath))
+            return;
         const char *vShaderCode = vertexCode.c_str();
         const char *fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -87,6 +100,9 @@ class Shader {
         glAttachShader(ID, fragment);
         if (geometryPath != nullptr)
             glAttachShader(ID, geometry);
+        if (!binaryPath.empty())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                GL_TRUE);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no
@@ -95,6 +111,8 @@ class Shader {
         glDeleteShader(fragment);
         if (geometryPath != nullptr)
             glDeleteShader(geometry);
+        if (!binaryPath.empty())
+            saveBinary(binaryPath);
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -102,54 +120,145 @@ class Shader {
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE,
                            &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE,
                            &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
                            &mat[0][0]);
     }
 
   private:
+    // uniform locations are fixed after linking, thus queried only once
+    // ------------------------------------------------------------------------
+    mutable std::unordered_map<std::string, GLint> uniformLocs;
+    GLint getUniformLocation(const std::string &name) const {
+        auto itr = uniformLocs.find(name);
+        if (itr != uniformLocs.end())
+            return itr->second;
+        auto loc = glGetUniformLocation(ID, name.c_str());
+        uniformLocs.emplace(name, loc);
+        return loc;
+    }
+    // program binary cache
+    // ------------------------------------------------------------------------
+    // file name is the FNV-1a hash of sources, vendor, renderer and version.
+    // return empty path if the driver supports no binary format
+    static std::filesystem::path
+    getBinaryPath(const char *dir, const std::string &vertexCode,
+                  const std::string &fragmentCode,
+                  const std::string &geometryCode) {
+        GLint formatNum = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatNum);
+        if (formatNum == 0)
+            return {};
+
+        uint64_t hash = 14695981039346656037ull;
+        auto accumulate = [&](const char *str) {
+            if (str == nullptr)
+                return;
+            for (; *str; ++str) {
+                hash ^= static_cast<uint8_t>(*str);
+                hash *= 1099511628211ull;
+            }
+            hash ^= 0xff; // separator
+            hash *= 1099511628211ull;
+        };
+        for (auto code : {&vertexCode, &fragmentCode, &geometryCode})
+            accumulate(code->c_str());
+        for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+            accumulate(reinterpret_cast<const char *>(glGetString(name)));
+
+        std::error_code err;
+        std::filesystem::create_directories(dir, err);
+        if (err)
+            return {};
+        std::ostringstream fileName;
+        fileName << std::hex << hash << ".bin";
+        return std::filesystem::path(dir) / fileName.str();
+    }
+    // file is a GLenum format followed by the binary
+    bool loadBinary(const std::filesystem::path &path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open())
+            return false;
+        auto size = static_cast<size_t>(in.tellg());
+        if (size <= sizeof(GLenum))
+            return false;
+        in.seekg(std::ios::beg);
+        GLenum format;
+        std::vector<char> binary(size - sizeof(GLenum));
+        in.read(reinterpret_cast<char *>(&format), sizeof(GLenum));
+        in.read(binary.data(), binary.size());
+        if (!in)
+            return false;
+
+        ID = glCreateProgram();
+        glProgramBinary(ID, format, binary.data(), binary.size());
+        GLint success;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            // stale or corrupted, fall back to compiling
+            glDeleteProgram(ID);
+            return false;
+        }
+        return true;
+    }
+    void saveBinary(const std::filesystem::path &path) const {
+        GLint success, size = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (!success || size == 0)
+            return;
+        GLenum format;
+        std::vector<char> binary(size);
+        glGetProgramBinary(ID, size, nullptr, &format, binary.data());
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return;
+        out.write(reinterpret_cast<const char *>(&format), sizeof(GLenum));
+        out.write(binary.data(), binary.size());
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type) {
@@ -0,0 +1,187 @@
+#ifndef KOUEK_TRACE_H
+#define KOUEK_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kouek {
+/// <summary>
+/// Process-wide recorder of spans, flushed as Chrome trace JSON
+/// (chrome://tracing, Perfetto). Each thread appends to its own buffer of
+/// chunks without locking, publishing the event count with release
+/// stores, thus FlushToJSON() can run concurrently with recording.
+/// The mutex is only taken when a thread records its first span and when
+/// flushing. Names and categories should be string literals, since only
+/// their pointers are kept.
+/// </summary>
+class Tracer {
+  public:
+    static constexpr size_t CHUNK_EVENT_NUM = 4096;
+    struct Event {
+        const char *cat;
+        const char *name;
+        uint64_t beginUS;
+        uint64_t durUS;
+    };
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    struct Chunk {
+        std::array<Event, CHUNK_EVENT_NUM> events;
+        std::atomic<size_t> cnt{0};
+        std::atomic<Chunk *> next{nullptr};
+    };
+    /// <summary>
+    /// Written only by its thread, read by flushers
+    /// </summary>
+    class ThreadBuffer {
+      private:
+        uint32_t tid;
+        std::unique_ptr<Chunk> head;
+        Chunk *tail;
+
+      public:
+        ThreadBuffer(uint32_t tid)
+            : tid(tid), head(std::make_unique<Chunk>()), tail(head.get()) {}
+        ~ThreadBuffer() {
+            auto chunk = head->next.load();
+            while (chunk) {
+                auto next = chunk->next.load();
+                delete chunk;
+                chunk = next;
+            }
+        }
+        inline auto GetTID() const { return tid; }
+        inline const Chunk *GetHead() const { return head.get(); }
+        void Append(const Event &event) {
+            auto cnt = tail->cnt.load(std::memory_order_relaxed);
+            if (cnt == CHUNK_EVENT_NUM) {
+                auto chunk = new Chunk;
+                tail->next.store(chunk, std::memory_order_release);
+                tail = chunk;
+                cnt = 0;
+            }
+            tail->events[cnt] = event;
+            tail->cnt.store(cnt + 1, std::memory_order_release);
+        }
+    };
+
+    std::atomic<bool> enabled{false};
+    Clock::time_point origin = Clock::now();
+    std::mutex bufMtx;
+    std::vector<std::unique_ptr<ThreadBuffer>> bufs;
+
+    Tracer() = default;
+
+  public:
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+    static Tracer &Instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+    inline void SetEnabled(bool enabled) {
+        this->enabled.store(enabled, std::memory_order_relaxed);
+    }
+    inline bool IsEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    inline uint64_t NowUS() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   Clock::now() - origin)
+            .count();
+    }
+    void Record(const char *cat, const char *name, uint64_t beginUS,
+                uint64_t endUS) {
+        thread_local ThreadBuffer *buf = registerThread();
+        buf->Append({cat, name, beginUS, endUS - beginUS});
+    }
+    /// <summary>
+    /// Write every event recorded so far. Return false if the file cannot
+    /// be written.
+    /// </summary>
+    bool FlushToJSON(const std::string &path) {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        std::lock_guard lk(bufMtx);
+        for (auto &buf : bufs)
+            for (auto chunk = buf->GetHead(); chunk;
+                 chunk = chunk->next.load(std::memory_order_acquire)) {
+                auto cnt = chunk->cnt.load(std::memory_order_acquire);
+                for (size_t i = 0; i < cnt; ++i) {
+                    auto &event = chunk->events[i];
+                    out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"pid\":1"
+                        << ",\"tid\":" << buf->GetTID() << ",\"cat\":\""
+                        << escape(event.cat) << "\",\"name\":\""
+                        << escape(event.name) << "\",\"ts\":" << event.beginUS
+                        << ",\"dur\":" << event.durUS << '}';
+                    first = false;
+                }
+            }
+        out << "\n]}\n";
+        return out.good();
+    }
+
+  private:
+    ThreadBuffer *registerThread() {
+        std::lock_guard lk(bufMtx);
+        bufs.emplace_back(
+            std::make_unique<ThreadBuffer>(static_cast<uint32_t>(bufs.size())));
+        return bufs.back().get();
+    }
+    static std::string escape(const char *str) {
+        std::string escaped;
+        for (; *str; ++str) {
+            if (*str == '"' || *str == '\\')
+                escaped.push_back('\\');
+            escaped.push_back(*str);
+        }
+        return escaped;
+    }
+};
+
+/// <summary>
+/// RAII span, recorded only if Tracer was enabled on construction
+/// </summary>
+class TraceSpan {
+  private:
+    const char *cat;
+    const char *name;
+    uint64_t beginUS;
+    bool enabled;
+
+  public:
+    TraceSpan(const char *cat, const char *name)
+        : cat(cat), name(name), enabled(Tracer::Instance().IsEnabled()) {
+        if (enabled)
+            beginUS = Tracer::Instance().NowUS();
+    }
+    ~TraceSpan() {
+        if (enabled)
+            Tracer::Instance().Record(cat, name, beginUS,
+                                      Tracer::Instance().NowUS());
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+};
+} // namespace kouek
+
+#define KOUEK_TRACE_CONCAT_IMPL(a, b) a##b
+#define KOUEK_TRACE_CONCAT(a, b) KOUEK_TRACE_CONCAT_IMPL(a, b)
+/// <summary>
+/// Trace the enclosing scope, e.g. KOUEK_TRACE_SCOPE("load", "Parse")
+/// </summary>
+#define KOUEK_TRACE_SCOPE(cat, name)                                           \
+    kouek::TraceSpan KOUEK_TRACE_CONCAT(kouekTraceSpan, __LINE__)(cat, name)
+
+#endif // !KOUEK_TRACE_H
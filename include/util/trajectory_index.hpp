@@ -0,0 +1,302 @@
+#ifndef KOUEK_TRAJECTORY_INDEX_H
+#define KOUEK_TRAJECTORY_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <stack>
+#include <vector>
+
+#include <util/point_octree.hpp>
+
+namespace kouek {
+/// <summary>
+/// Spatio-temporal index over trajectories stored time-major, i.e.
+/// verts[timeStep][vertIdx], which is the layout of
+/// WormNeuronPositionData::GetVerts().
+/// Time steps are grouped into windows of leafSpan steps and windows are
+/// organized as a segment tree. Each tree node keeps the swept AABB of
+/// every trajectory through its time span, plus a PointOctree over the
+/// AABB centers for loose spatial queries.
+/// verts should outlive the index and stay unchanged.
+/// </summary>
+class TrajectoryIndex {
+  public:
+    static constexpr uint32_t DEFAULT_LEAF_SPAN = 8;
+
+  private:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct TimeNode {
+        std::vector<std::array<glm::vec3, 2>> boxes;
+        /// <summary>
+        /// Trajectories whose AABB centers are the same are chained,
+        /// since only the chain head is stored in octree
+        /// </summary>
+        std::vector<uint32_t> nexts;
+        glm::vec3 maxHalfExt{0};
+        std::unique_ptr<PointOctree<uint32_t>> octree;
+    };
+
+    uint32_t leafSpan;
+    size_t timeCnt = 0, vertCnt = 0;
+    const std::vector<std::vector<glm::vec3>> *verts;
+    /// <summary>
+    /// levels[0] holds the windows, levels.back() holds the root
+    /// </summary>
+    std::vector<std::vector<TimeNode>> levels;
+
+  public:
+    TrajectoryIndex(const std::vector<std::vector<glm::vec3>> &verts,
+                    uint32_t leafSpan = DEFAULT_LEAF_SPAN)
+        : leafSpan(leafSpan), verts(&verts) {
+        assert(leafSpan > 0);
+        if (verts.empty() || verts.front().empty())
+            return;
+        timeCnt = verts.size();
+        vertCnt = verts.front().size();
+
+        glm::vec3 min{+std::numeric_limits<float>::infinity()};
+        glm::vec3 max{-std::numeric_limits<float>::infinity()};
+        for (const auto &vertsT : verts)
+            for (const auto &pos : vertsT) {
+                min = glm::min(min, pos);
+                max = glm::max(max, pos);
+            }
+
+        // windows
+        levels.emplace_back((timeCnt + leafSpan - 1) / leafSpan);
+        for (size_t winIdx = 0; winIdx < levels[0].size(); ++winIdx) {
+            auto &boxes = levels[0][winIdx].boxes;
+            boxes.resize(vertCnt);
+            auto tStart = winIdx * leafSpan;
+            auto tEnd = std::min(tStart + leafSpan, timeCnt);
+            for (size_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+                boxes[vertIdx][0] = boxes[vertIdx][1] =
+                    verts[tStart][vertIdx];
+            for (auto t = tStart + 1; t < tEnd; ++t)
+                for (size_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx) {
+                    auto &box = boxes[vertIdx];
+                    box[0] = glm::min(box[0], verts[t][vertIdx]);
+                    box[1] = glm::max(box[1], verts[t][vertIdx]);
+                }
+        }
+        // upper levels merge pairs of lower nodes
+        while (levels.back().size() > 1) {
+            auto &lower = levels.back();
+            std::vector<TimeNode> upper((lower.size() + 1) / 2);
+            for (size_t nodeIdx = 0; nodeIdx < upper.size(); ++nodeIdx) {
+                upper[nodeIdx].boxes = lower[nodeIdx * 2].boxes;
+                if (nodeIdx * 2 + 1 == lower.size())
+                    continue;
+                auto &rhtBoxes = lower[nodeIdx * 2 + 1].boxes;
+                for (size_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx) {
+                    auto &box = upper[nodeIdx].boxes[vertIdx];
+                    box[0] = glm::min(box[0], rhtBoxes[vertIdx][0]);
+                    box[1] = glm::max(box[1], rhtBoxes[vertIdx][1]);
+                }
+            }
+            levels.emplace_back(std::move(upper));
+        }
+
+        for (auto &level : levels)
+            for (auto &node : level) {
+                node.octree = std::make_unique<PointOctree<uint32_t>>(min, max);
+                node.nexts.assign(vertCnt, NONE);
+                for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx) {
+                    auto &box = node.boxes[vertIdx];
+                    node.maxHalfExt =
+                        glm::max(node.maxHalfExt, .5f * (box[1] - box[0]));
+                    auto cntr = .5f * (box[0] + box[1]);
+                    auto [leaf, datIdx] = node.octree->Query(cntr, 0);
+                    if (leaf) {
+                        node.nexts[vertIdx] = leaf->dat[datIdx].second;
+                        leaf->dat[datIdx].second = vertIdx;
+                    } else
+                        node.octree->Insert(cntr, vertIdx, 0);
+                }
+            }
+    }
+    inline auto GetTimeCnt() const { return timeCnt; }
+    inline auto GetVertCnt() const { return vertCnt; }
+    /// <summary>
+    /// Return sorted indices of trajectories which are inside AABB
+    /// [min, max] at any time step in [t0, t1]
+    /// </summary>
+    std::vector<uint32_t> Query(const glm::vec3 &min, const glm::vec3 &max,
+                                size_t t0, size_t t1) const {
+        std::vector<uint32_t> ret;
+        if (timeCnt == 0 || t0 > t1 || t0 >= timeCnt)
+            return ret;
+        if (t1 >= timeCnt)
+            t1 = timeCnt - 1;
+
+        size_t lo = t0 / leafSpan, hi = t1 / leafSpan + 1;
+        bool loPartial = t0 % leafSpan != 0;
+        bool hiPartial = t1 % leafSpan != leafSpan - 1 && t1 != timeCnt - 1;
+        if (lo + 1 == hi && (loPartial || hiPartial)) {
+            queryWindowPart(lo, t0, t1, min, max, ret);
+            return unique(ret);
+        }
+        if (loPartial) {
+            queryWindowPart(lo, t0, (lo + 1) * leafSpan - 1, min, max, ret);
+            ++lo;
+        }
+        if (hiPartial) {
+            --hi;
+            queryWindowPart(hi, hi * leafSpan, t1, min, max, ret);
+        }
+        // cover [lo, hi) with segment tree nodes bottom-up
+        for (size_t lvl = 0; lo < hi; ++lvl, lo >>= 1, hi >>= 1) {
+            if (lo & 0x1)
+                queryNode(lvl, lo++, min, max, ret);
+            if (hi & 0x1)
+                queryNode(lvl, --hi, min, max, ret);
+        }
+        return unique(ret);
+    }
+
+    /// <summary>
+    /// Overwrite ret with sorted indices of trajectories which may be
+    /// inside frustum at some time step in [t0, t1], when swollen by margin,
+    /// e.g. the radius of spheres placed on them.
+    /// Swept AABBs of the whole windows covering [t0, t1] are tested, thus
+    /// the result is conservative, which suits culling every frame.
+    /// </summary>
+    void Query(const Frustum &frustum, size_t t0, size_t t1,
+               const glm::vec3 &margin, std::vector<uint32_t> &ret) const {
+        ret.clear();
+        if (timeCnt == 0 || t0 > t1 || t0 >= timeCnt)
+            return;
+        if (t1 >= timeCnt)
+            t1 = timeCnt - 1;
+
+        size_t lo = t0 / leafSpan, hi = t1 / leafSpan + 1;
+        for (size_t lvl = 0; lo < hi; ++lvl, lo >>= 1, hi >>= 1) {
+            if (lo & 0x1)
+                queryNode(lvl, lo++, frustum, margin, ret);
+            if (hi & 0x1)
+                queryNode(lvl, --hi, frustum, margin, ret);
+        }
+        unique(ret);
+    }
+    std::vector<uint32_t> Query(const Frustum &frustum, size_t t0, size_t t1,
+                                const glm::vec3 &margin = glm::vec3{0}) const {
+        std::vector<uint32_t> ret;
+        Query(frustum, t0, t1, margin, ret);
+        return ret;
+    }
+
+  private:
+    static inline std::vector<uint32_t> &unique(std::vector<uint32_t> &ret) {
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+    static inline bool isInside(const glm::vec3 &pos, const glm::vec3 &min,
+                                const glm::vec3 &max) {
+        return pos.x >= min.x && pos.y >= min.y && pos.z >= min.z &&
+               pos.x <= max.x && pos.y <= max.y && pos.z <= max.z;
+    }
+    /// <summary>
+    /// Collect trajectories whose AABBs of node may intersect [min, max]
+    /// </summary>
+    template <typename Func>
+    void forEachCandidate(const TimeNode &node, const glm::vec3 &min,
+                          const glm::vec3 &max, Func &&func) const {
+        auto heads =
+            node.octree->QueryDat(min - node.maxHalfExt, max + node.maxHalfExt);
+        for (auto vertIdx : heads)
+            for (; vertIdx != NONE; vertIdx = node.nexts[vertIdx]) {
+                auto &box = node.boxes[vertIdx];
+                if (box[1].x < min.x || box[1].y < min.y || box[1].z < min.z ||
+                    box[0].x > max.x || box[0].y > max.y || box[0].z > max.z)
+                    continue;
+                func(vertIdx);
+            }
+    }
+    void queryWindowPart(size_t winIdx, size_t t0, size_t t1,
+                         const glm::vec3 &min, const glm::vec3 &max,
+                         std::vector<uint32_t> &ret) const {
+        forEachCandidate(levels[0][winIdx], min, max, [&](uint32_t vertIdx) {
+            for (auto t = t0; t <= t1; ++t)
+                if (isInside((*verts)[t][vertIdx], min, max)) {
+                    ret.emplace_back(vertIdx);
+                    return;
+                }
+        });
+    }
+    void queryNode(size_t lvl, size_t nodeIdx, const glm::vec3 &min,
+                   const glm::vec3 &max, std::vector<uint32_t> &ret) const {
+        forEachCandidate(levels[lvl][nodeIdx], min, max, [&](uint32_t vertIdx) {
+            if (isPassing(lvl, nodeIdx, vertIdx, min, max))
+                ret.emplace_back(vertIdx);
+        });
+    }
+    /// <summary>
+    /// Octree nodes are swollen by maxHalfExt, since they bound the AABB
+    /// centers only. Faces which a node lies totally inside are not tested
+    /// again in its subtree.
+    /// </summary>
+    void queryNode(size_t lvl, size_t nodeIdx, const Frustum &frustum,
+                   const glm::vec3 &margin, std::vector<uint32_t> &ret) const {
+        using OctrNodeTy = PointOctree<uint32_t>::Node;
+        auto &node = levels[lvl][nodeIdx];
+        auto ext = node.maxHalfExt + margin;
+        std::stack<std::pair<const OctrNodeTy *, uint8_t>> stk;
+        stk.emplace(&node.octree->GetRoot(), Frustum::ALL_FACES_MASK);
+        while (!stk.empty()) {
+            auto [curr, planeMask] = stk.top();
+            stk.pop();
+            if (planeMask != 0 &&
+                !frustum.IsIntersectedWithAABB(curr->min - ext,
+                                               curr->max + ext, planeMask))
+                continue;
+            if (curr->datNum == 0) {
+                for (uint8_t chIdx = 0; chIdx < 8; ++chIdx)
+                    if (curr->children[chIdx])
+                        stk.emplace(curr->children[chIdx], planeMask);
+                continue;
+            }
+            for (uint8_t datIdx = 0; datIdx < curr->datNum; ++datIdx)
+                for (auto vertIdx = curr->dat[datIdx].second; vertIdx != NONE;
+                     vertIdx = node.nexts[vertIdx]) {
+                    auto &box = node.boxes[vertIdx];
+                    auto boxMask = planeMask;
+                    if (boxMask == 0 ||
+                        frustum.IsIntersectedWithAABB(box[0] - margin,
+                                                      box[1] + margin, boxMask))
+                        ret.emplace_back(vertIdx);
+                }
+        }
+    }
+    /// <summary>
+    /// Refine a candidate down the segment tree. An AABB inside [min, max]
+    /// accepts the trajectory directly, since it bounds the samples tightly.
+    /// </summary>
+    bool isPassing(size_t lvl, size_t nodeIdx, uint32_t vertIdx,
+                   const glm::vec3 &min, const glm::vec3 &max) const {
+        auto &box = levels[lvl][nodeIdx].boxes[vertIdx];
+        if (box[1].x < min.x || box[1].y < min.y || box[1].z < min.z ||
+            box[0].x > max.x || box[0].y > max.y || box[0].z > max.z)
+            return false;
+        if (isInside(box[0], min, max) && isInside(box[1], min, max))
+            return true;
+        if (lvl == 0) {
+            auto tStart = nodeIdx * leafSpan;
+            auto tEnd = std::min(tStart + leafSpan, timeCnt);
+            for (auto t = tStart; t < tEnd; ++t)
+                if (isInside((*verts)[t][vertIdx], min, max))
+                    return true;
+            return false;
+        }
+        auto chIdx = nodeIdx * 2;
+        return isPassing(lvl - 1, chIdx, vertIdx, min, max) ||
+               (chIdx + 1 < levels[lvl - 1].size() &&
+                isPassing(lvl - 1, chIdx + 1, vertIdx, min, max));
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_TRAJECTORY_INDEX_H
@@ -0,0 +1,41 @@
+#ifndef KOUEK_UNIFORM_BUFFER_H
+#define KOUEK_UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+namespace kouek {
+/// <summary>
+/// Uniform buffer holding one BlockTy, bound to a fixed binding point.
+/// BlockTy should follow std140 layout, i.e. vec3 and vec4 are aligned to
+/// 16 bytes and mat4 is 4 vec4 columns, which should be checked by
+/// static_assert on offsetof() where the block is declared.
+/// Shaders declare the block with layout(std140, binding = ...), thus every
+/// program sees the same data after a single Upload().
+/// </summary>
+template <typename BlockTy> class UniformBuffer {
+  private:
+    GLuint binding;
+    GLuint UBO;
+
+  public:
+    UniformBuffer(GLuint binding) : binding(binding) {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(BlockTy), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+    }
+    ~UniformBuffer() { glDeleteBuffers(1, &UBO); }
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+    inline auto GetBinding() const { return binding; }
+    void Upload(const BlockTy &block) {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(BlockTy), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_UNIFORM_BUFFER_H
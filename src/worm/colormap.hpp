@@ -0,0 +1,55 @@
+#ifndef KOUEK_COLORMAP_H
+#define KOUEK_COLORMAP_H
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kouek {
+enum class Colormap : uint8_t { Viridis, Hot, CoolWarm, Gray };
+
+/// <summary>
+/// Sample colormap uniformly into sampleNum colors from low to high,
+/// linearly interpolated between a few stops of it
+/// </summary>
+inline std::vector<glm::vec3> SampleColormap(Colormap colormap,
+                                             size_t sampleNum) {
+    static constexpr std::array VIRIDIS{
+        glm::vec3{.267f, .005f, .329f}, glm::vec3{.229f, .322f, .546f},
+        glm::vec3{.128f, .567f, .551f}, glm::vec3{.369f, .789f, .383f},
+        glm::vec3{.993f, .906f, .144f}};
+    static constexpr std::array HOT{
+        glm::vec3{.04f, 0, 0}, glm::vec3{1.f, 0, 0}, glm::vec3{1.f, 1.f, 0},
+        glm::vec3{1.f, 1.f, 1.f}};
+    static constexpr std::array COOL_WARM{glm::vec3{.230f, .299f, .754f},
+                                          glm::vec3{.865f, .865f, .865f},
+                                          glm::vec3{.706f, .016f, .150f}};
+    static constexpr std::array GRAY{glm::vec3{0}, glm::vec3{1.f}};
+
+    auto sample = [&](const auto &stops) {
+        std::vector<glm::vec3> colors(sampleNum);
+        for (size_t i = 0; i < sampleNum; ++i) {
+            auto x = sampleNum == 1 ? 0.f
+                                    : static_cast<float>(i) / (sampleNum - 1) *
+                                          (stops.size() - 1);
+            auto lft = std::min(static_cast<size_t>(x), stops.size() - 2);
+            colors[i] = glm::mix(stops[lft], stops[lft + 1], x - lft);
+        }
+        return colors;
+    };
+    switch (colormap) {
+    case Colormap::Hot:
+        return sample(HOT);
+    case Colormap::CoolWarm:
+        return sample(COOL_WARM);
+    case Colormap::Gray:
+        return sample(GRAY);
+    default:
+        return sample(VIRIDIS);
+    }
+}
+} // namespace kouek
+
+#endif // !KOUEK_COLORMAP_H
@@ -5,6 +5,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <QtGui/qevent.h>
+#include <QtGui/qfontdatabase.h>
+#include <QtGui/qpainter.h>
 #include <QtWidgets/qopenglwidget.h>
 
 #include "worm_renderer.hpp"
@@ -55,6 +57,17 @@ signals:
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         if (renderer)
             renderer->Render();
+        if (renderer && renderer->GetProfiler().IsEnabled()) {
+            // overlay of rolling frame time statistics
+            QPainter painter(this);
+            painter.setPen(Qt::yellow);
+            painter.setFont(
+                QFontDatabase::systemFont(QFontDatabase::FixedFont));
+            painter.drawText(rect().adjusted(8, 8, -8, -8),
+                             Qt::AlignLeft | Qt::AlignTop,
+                             QString::fromStdString(
+                                 renderer->GetProfiler().FormatStats()));
+        }
     }
 
   protected:
@@ -0,0 +1,135 @@
+#ifndef KOUEK_HEADLESS_CONTEXT_H
+#define KOUEK_HEADLESS_CONTEXT_H
+
+#if defined(KOUEK_HEADLESS_EGL) || defined(KOUEK_HEADLESS_OSMESA)
+#define KOUEK_HEADLESS
+
+#include <stdexcept>
+#include <vector>
+
+#include <glad/glad.h>
+
+#ifdef KOUEK_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GL/osmesa.h>
+#endif
+
+namespace kouek {
+/// <summary>
+/// OpenGL 4.5 core context without any window, made current on
+/// construction. Rendering should go to an FBO, see OffscreenRecorder.
+/// Built with EGL (KOUEK_HEADLESS_EGL) or OSMesa (KOUEK_HEADLESS_OSMESA),
+/// the latter renders on CPU, e.g. on CI machines without GPU.
+/// </summary>
+class HeadlessContext {
+  private:
+#ifdef KOUEK_HEADLESS_EGL
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+#else
+    OSMesaContext context;
+    std::vector<uint8_t> dummyBuf;
+#endif
+
+  public:
+    HeadlessContext() {
+#ifdef KOUEK_HEADLESS_EGL
+        // fall back to Mesa's surfaceless platform if no display server
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY ||
+            !eglInitialize(display, nullptr, nullptr)) {
+            auto getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+                    "eglGetPlatformDisplayEXT");
+            display = getPlatformDisplay
+                          ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                               EGL_DEFAULT_DISPLAY, nullptr)
+                          : EGL_NO_DISPLAY;
+            if (display == EGL_NO_DISPLAY ||
+                !eglInitialize(display, nullptr, nullptr))
+                throw std::runtime_error("Cannot initialize EGL display");
+        }
+
+        const EGLint cfgAttribs[] = {EGL_SURFACE_TYPE,
+                                     EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE,
+                                     EGL_OPENGL_BIT,
+                                     EGL_RED_SIZE,
+                                     8,
+                                     EGL_GREEN_SIZE,
+                                     8,
+                                     EGL_BLUE_SIZE,
+                                     8,
+                                     EGL_DEPTH_SIZE,
+                                     24,
+                                     EGL_NONE};
+        EGLConfig cfg;
+        EGLint cfgNum;
+        if (!eglChooseConfig(display, cfgAttribs, &cfg, 1, &cfgNum) ||
+            cfgNum == 0)
+            throw std::runtime_error("Cannot choose EGL config");
+        // a 1x1 pbuffer only to make context current
+        const EGLint pbufAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, cfg, pbufAttribs);
+
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint ctxAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     4,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     5,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+        context = eglCreateContext(display, cfg, EGL_NO_CONTEXT, ctxAttribs);
+        if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+            !eglMakeCurrent(display, surface, surface, context))
+            throw std::runtime_error("Cannot create EGL context");
+        auto hasInit = gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+#else
+        const int ctxAttribs[] = {OSMESA_FORMAT,
+                                  OSMESA_RGBA,
+                                  OSMESA_DEPTH_BITS,
+                                  24,
+                                  OSMESA_STENCIL_BITS,
+                                  8,
+                                  OSMESA_PROFILE,
+                                  OSMESA_CORE_PROFILE,
+                                  OSMESA_CONTEXT_MAJOR_VERSION,
+                                  4,
+                                  OSMESA_CONTEXT_MINOR_VERSION,
+                                  5,
+                                  0};
+        context = OSMesaCreateContextAttribs(ctxAttribs, nullptr);
+        // a 1x1 buffer only to make context current
+        dummyBuf.resize(4);
+        if (!context || !OSMesaMakeCurrent(context, dummyBuf.data(),
+                                           GL_UNSIGNED_BYTE, 1, 1))
+            throw std::runtime_error("Cannot create OSMesa context");
+        auto hasInit = gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress);
+#endif
+        if (!hasInit)
+            throw std::runtime_error("Cannot load OpenGL functions");
+        glClearColor(0.f, 0.f, 0.f, 1.f);
+    }
+    ~HeadlessContext() {
+#ifdef KOUEK_HEADLESS_EGL
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglDestroySurface(display, surface);
+        eglTerminate(display);
+#else
+        OSMesaDestroyContext(context);
+#endif
+    }
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+};
+} // namespace kouek
+
+#endif // KOUEK_HEADLESS_EGL || KOUEK_HEADLESS_OSMESA
+
+#endif // !KOUEK_HEADLESS_CONTEXT_H
@@ -0,0 +1,119 @@
+#include "image_write.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> flipToRGBRows(const uint8_t *dat, int width, int height,
+                                   int nrChannels, bool withFilterByte) {
+    size_t rowSize = 3 * width + (withFilterByte ? 1 : 0);
+    std::vector<uint8_t> rows(rowSize * height);
+    for (int y = 0; y < height; ++y) {
+        auto src = dat + (size_t)(height - 1 - y) * width * nrChannels;
+        auto dst = rows.data() + rowSize * y;
+        if (withFilterByte)
+            *dst++ = 0; // filter type None
+        for (int x = 0; x < width; ++x, src += nrChannels)
+            for (uint8_t rgb = 0; rgb < 3; ++rgb)
+                *dst++ = src[rgb];
+    }
+    return rows;
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t *dat, size_t size) {
+    static const auto TABLE = []() {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; ++i) {
+            auto c = i;
+            for (uint8_t k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = TABLE[(crc ^ dat[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void appendBE32(std::vector<uint8_t> &out, uint32_t val) {
+    out.insert(out.end(), {static_cast<uint8_t>(val >> 24),
+                           static_cast<uint8_t>(val >> 16),
+                           static_cast<uint8_t>(val >> 8),
+                           static_cast<uint8_t>(val)});
+}
+
+void writeChunk(std::ofstream &out, const char *type,
+                const std::vector<uint8_t> &dat) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(12 + dat.size());
+    appendBE32(chunk, static_cast<uint32_t>(dat.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), dat.begin(), dat.end());
+    appendBE32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+    out.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+} // namespace
+
+bool kouek::WriteRawToPPM(const std::string &path, const uint8_t *dat,
+                          int width, int height, int nrChannels) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    auto rows = flipToRGBRows(dat, width, height, nrChannels, false);
+    out << "P6\n" << width << ' ' << height << "\n255\n";
+    out.write(reinterpret_cast<const char *>(rows.data()), rows.size());
+    return out.good();
+}
+
+bool kouek::WriteRawToPNG(const std::string &path, const uint8_t *dat,
+                          int width, int height, int nrChannels) {
+    static constexpr std::array<uint8_t, 8> SIGNATURE{0x89, 'P',  'N',  'G',
+                                                      '\r', '\n', 0x1a, '\n'};
+    static constexpr size_t MAX_STORED_SIZE = 65535;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write(reinterpret_cast<const char *>(SIGNATURE.data()),
+              SIGNATURE.size());
+
+    std::vector<uint8_t> header;
+    appendBE32(header, width);
+    appendBE32(header, height);
+    // bit depth 8, color type RGB, deflate, adaptive filter, no interlace
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    writeChunk(out, "IHDR", header);
+
+    // zlib stream of stored blocks, each holding at most MAX_STORED_SIZE
+    auto rows = flipToRGBRows(dat, width, height, nrChannels, true);
+    std::vector<uint8_t> zlib;
+    zlib.reserve(rows.size() + 5 * (rows.size() / MAX_STORED_SIZE + 1) + 6);
+    zlib.insert(zlib.end(), {0x78, 0x01});
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t beg = 0;; beg += MAX_STORED_SIZE) {
+        auto size = static_cast<uint16_t>(
+            std::min(MAX_STORED_SIZE, rows.size() - beg));
+        auto isLast = beg + size == rows.size();
+        zlib.insert(zlib.end(),
+                    {static_cast<uint8_t>(isLast ? 1 : 0),
+                     static_cast<uint8_t>(size),
+                     static_cast<uint8_t>(size >> 8),
+                     static_cast<uint8_t>(~size),
+                     static_cast<uint8_t>(~size >> 8)});
+        zlib.insert(zlib.end(), rows.begin() + beg, rows.begin() + beg + size);
+        for (size_t i = beg; i < beg + size; ++i) {
+            adlerA = (adlerA + rows[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        if (isLast)
+            break;
+    }
+    appendBE32(zlib, (adlerB << 16) | adlerA);
+    writeChunk(out, "IDAT", zlib);
+    writeChunk(out, "IEND", {});
+    return out.good();
+}
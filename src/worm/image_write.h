@@ -0,0 +1,23 @@
+#ifndef KOUEK_IMAGE_WRITE_H
+#define KOUEK_IMAGE_WRITE_H
+
+#include <cstdint>
+#include <string>
+
+namespace kouek {
+/// <summary>
+/// Write 8-bit RGB or RGBA pixels (nrChannels is 3 or 4) to file.
+/// Rows of dat go from bottom to top, as read back by glReadPixels().
+/// Alpha is dropped. Return false if the file cannot be written.
+/// </summary>
+bool WriteRawToPPM(const std::string &path, const uint8_t *dat, int width,
+                   int height, int nrChannels);
+/// <summary>
+/// Same as WriteRawToPPM(), but PNG with stored (uncompressed) deflate
+/// blocks, since no compressor is shipped in 3rd
+/// </summary>
+bool WriteRawToPNG(const std::string &path, const uint8_t *dat, int width,
+                   int height, int nrChannels);
+} // namespace kouek
+
+#endif // !KOUEK_IMAGE_WRITE_H
@@ -1,12 +1,149 @@
+#include <cstdlib>
+#include <iostream>
+
 #include <QtWidgets/qapplication.h>
 
+#include <util/trace.hpp>
+
+#include "headless_context.hpp"
 #include "main_window.hpp"
 
+#ifdef KOUEK_HEADLESS
+#include <chrono>
+#include <limits>
+#include <string_view>
+
+#include "offscreen_recorder.hpp"
+#endif
+
 using namespace kouek;
 
+#ifdef KOUEK_HEADLESS
+/// <summary>
+/// SimWorm --record <worm position file> <output dir>
+///   [--begin <time step>] [--end <time step>]
+///   [--width <px>] [--height <px>] [--format png|ppm] [--focus]
+/// Render time steps in [begin, end) of worm with the default camera of
+/// MainWindow, without opening any window.
+/// </summary>
+static int record(int argc, char **argv) {
+    static constexpr float FOV = 90.f;
+    static constexpr float N_CLIP = .001f;
+    static constexpr float F_CLIP = 10.F;
+
+    auto usage = [&]() {
+        std::cout << "Usage: " << argv[0]
+                  << " --record <worm position file> <output dir> "
+                     "[--begin N] [--end N] [--width W] [--height H] "
+                     "[--format png|ppm] [--focus]"
+                  << std::endl;
+        return 1;
+    };
+    if (argc < 4)
+        return usage();
+
+    try {
+        std::string wpdPath = argv[2], outDir = argv[3];
+        size_t beg = 0, end = std::numeric_limits<size_t>::max();
+        GLsizei width = 1280, height = 720;
+        auto format = OffscreenRecorder::ImageFormat::PNG;
+        auto sceneMode = WormRenderer::SceneMode::Full;
+        for (int i = 4; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            auto hasVal = i + 1 < argc;
+            try {
+                if (arg == "--begin" && hasVal)
+                    beg = std::stoull(argv[++i]);
+                else if (arg == "--end" && hasVal)
+                    end = std::stoull(argv[++i]);
+                else if (arg == "--width" && hasVal)
+                    width = std::stoi(argv[++i]);
+                else if (arg == "--height" && hasVal)
+                    height = std::stoi(argv[++i]);
+                else if (arg == "--format" && hasVal)
+                    format = std::string_view(argv[++i]) == "ppm"
+                                 ? OffscreenRecorder::ImageFormat::PPM
+                                 : OffscreenRecorder::ImageFormat::PNG;
+                else if (arg == "--focus")
+                    sceneMode = WormRenderer::SceneMode::Focus;
+                else {
+                    std::cout << "Unknown argument: " << arg << std::endl;
+                    return usage();
+                }
+            } catch (std::logic_error &) {
+                // std::invalid_argument or std::out_of_range of std::sto*
+                std::cout << "Invalid value of " << arg << ": " << argv[i]
+                          << std::endl;
+                return usage();
+            }
+        }
+        if (width <= 0 || height <= 0) {
+            std::cout << "Width and height should be positive" << std::endl;
+            return usage();
+        }
+
+        HeadlessContext ctx;
+        auto wpd = std::make_shared<WormPositionData>(wpdPath);
+        end = std::min(end, wpd->GetVerts().size());
+
+        WormRenderer renderer;
+        renderer.SetDivisionNum(16);
+        renderer.SetWormPositionDat(wpd);
+        renderer.SetRenderTarget(WormRenderer::RenderTarget::Worm);
+        renderer.SetSceneMode(sceneMode);
+        FPSCamera camera(glm::vec3{0, 0, 1.f}, glm::zero<glm::vec3>());
+        renderer.SetCamera(camera.getViewMat(),
+                           glm::perspectiveFov(glm::radians(FOV), (float)width,
+                                               (float)height, N_CLIP, F_CLIP));
+
+        OffscreenRecorder recorder(width, height);
+        recorder.SetImageFormat(format);
+        auto start = std::chrono::steady_clock::now();
+        recorder.Record(renderer, beg, end, outDir);
+        auto sec = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+        std::cout << "Recorded " << (end > beg ? end - beg : 0)
+                  << " frames in " << sec << " s" << std::endl;
+    } catch (std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+/// <summary>
+/// Write spans recorded so far to the path in KOUEK_TRACE if it is set
+/// </summary>
+static void flushTrace() {
+    auto path = std::getenv("KOUEK_TRACE");
+    if (!path)
+        return;
+    if (Tracer::Instance().FlushToJSON(path))
+        std::cout << "Trace written to " << path << std::endl;
+    else
+        std::cout << "Cannot write trace to " << path << std::endl;
+}
+
 int main(int argc, char **argv) {
+    // KOUEK_TRACE=<json path> records spans of loading, fitting,
+    // registering and rendering, viewable in chrome://tracing or Perfetto
+    if (std::getenv("KOUEK_TRACE"))
+        Tracer::Instance().SetEnabled(true);
+
+#ifdef KOUEK_HEADLESS
+    if (argc > 1 && std::string_view(argv[1]) == "--record") {
+        auto ret = record(argc, argv);
+        flushTrace();
+        return ret;
+    }
+#endif
+
     QApplication app(argc, argv);
     MainWindow window;
     window.showMaximized();
-    return app.exec();
+    auto ret = app.exec();
+    flushTrace();
+    return ret;
 }
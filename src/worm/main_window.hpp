@@ -2,7 +2,9 @@
 #define KOUEK_MAIN_WINDOW_H
 
 #include <memory>
+#include <vector>
 
+#include <QtCore/qtimer.h>
 #include <QtWidgets/qfiledialog.h>
 #include <QtWidgets/qgraphicsview.h>
 #include <QtWidgets/qwidget.h>
@@ -14,6 +16,7 @@
 #include <util/math.h>
 
 #include "gl_view.hpp"
+#include "playback_controller.hpp"
 
 namespace Ui {
 class MainWindow;
@@ -32,6 +35,7 @@ class MainWindow : public QWidget {
 
     std::shared_ptr<WormPositionData> wpd;
     std::shared_ptr<WormNeuronPositionData> wnpd;
+    std::shared_ptr<WormNeuronActivityData> wnad;
     std::shared_ptr<WormRenderer> renderer;
 
     bool isSelectingInliers = false;
@@ -41,6 +45,8 @@ class MainWindow : public QWidget {
     glm::mat4 proj, unProj, wnpdModelRev;
     std::array<glm::vec2, 2> inliersSelectFrame;
     FPSCamera camera;
+    QTimer playTimer;
+    PlaybackController playback;
 
   public:
     explicit MainWindow(QWidget *parent = Q_NULLPTR)
@@ -54,6 +60,7 @@ class MainWindow : public QWidget {
 
         ui->groupBoxWNPD->setEnabled(false);
         ui->groupBoxReg->setEnabled(false);
+        ui->groupBoxActivity->setEnabled(false);
         ui->groupBoxRendering->setEnabled(false);
         ui->groupBoxTimeStep->setEnabled(false);
         ui->groupBoxLighting->setEnabled(false);
@@ -69,15 +76,19 @@ class MainWindow : public QWidget {
                 wpd = std::make_shared<WormPositionData>(path.toStdString());
 
                 wnpd.reset();
+                resetActivity();
                 ui->labelWPDPath->setText(path);
                 ui->horizontalSliderTiemStep->setMaximum(
                     wpd->GetVerts().size() - 1);
                 ui->labelMinTimeStep->setText(QString::number(0));
                 ui->labelMaxTimeStep->setText(
                     QString::number(wpd->GetVerts().size() - 1));
+                ui->pushButtonPlay->setChecked(false);
+                playback.SetTimeStepNum(wpd->GetVerts().size());
 
                 ui->groupBoxWNPD->setEnabled(true);
                 ui->groupBoxReg->setEnabled(false);
+                ui->groupBoxActivity->setEnabled(false);
                 ui->groupBoxRendering->setEnabled(true);
                 ui->groupBoxTimeStep->setEnabled(true);
                 ui->groupBoxLighting->setEnabled(true);
@@ -100,6 +111,8 @@ class MainWindow : public QWidget {
                 glView->makeCurrent();
                 wnpd = std::make_shared<WormNeuronPositionData>(
                     path.toStdString(), wpd);
+                resetActivity();
+                ui->groupBoxActivity->setEnabled(false);
                 {
                     auto [min, max] = wnpd->GetPosRange();
                     glm::vec3 offset{-.5f * (max + min)};
@@ -125,6 +138,7 @@ class MainWindow : public QWidget {
                 ui->comboBoxSceneMode->setCurrentIndex(
                     static_cast<int>(WormRenderer::SceneMode::Full));
                 ui->doubleSpinBoxNuroHfWid->setValue(NURO_HF_WID);
+                ui->pushButtonPlay->setChecked(false);
                 ui->groupBoxTimeStep->setEnabled(false);
 
                 glView->update();
@@ -233,6 +247,7 @@ class MainWindow : public QWidget {
                 });
         connect(ui->pushButtonReg, &QPushButton::clicked, [&]() {
             ui->groupBoxReg->setEnabled(false);
+            ui->groupBoxActivity->setEnabled(true);
             ui->groupBoxTimeStep->setEnabled(true);
 
             glView->makeCurrent();
@@ -241,6 +256,59 @@ class MainWindow : public QWidget {
                 WormRenderer::RenderTarget::WormAndNeuron);
             glView->update();
         });
+        connect(ui->toolButtonBroswerActivity, &QToolButton::clicked, [&]() {
+            auto path = QFileDialog::getOpenFileName(
+                this, tr("Open Neuron Activity Data (float[T][N])"));
+            if (path.isEmpty())
+                return;
+            try {
+                glView->makeCurrent();
+                wnad = std::make_shared<WormNeuronActivityData>(
+                    path.toStdString(), wnpd->GetVerts().front().size());
+                renderer->SetWormNeuronActivityDat(wnad);
+                // page in activities ahead of playback
+                playback.SetPrefetcher(
+                    wnad->GetPrefetcher(),
+                    PlaybackController::DEFAULT_PREFETCH_NUM);
+
+                // show the sampled range without setting it back
+                auto [min, max] = wnad->GetRange();
+                ui->doubleSpinBoxActivityMin->blockSignals(true);
+                ui->doubleSpinBoxActivityMax->blockSignals(true);
+                ui->doubleSpinBoxActivityMin->setValue(min);
+                ui->doubleSpinBoxActivityMax->setValue(max);
+                ui->doubleSpinBoxActivityMin->blockSignals(false);
+                ui->doubleSpinBoxActivityMax->blockSignals(false);
+
+                ui->labelActivityPath->setText(path);
+                glView->update();
+            } catch (std::exception &e) {
+                resetActivity();
+                ui->labelActivityPath->setText(e.what());
+            }
+        });
+        connect(ui->doubleSpinBoxActivityMin,
+                QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+                [&](double val) {
+                    if (!wnad)
+                        return;
+                    wnad->SetRange(val, wnad->GetRange().second);
+                    glView->update();
+                });
+        connect(ui->doubleSpinBoxActivityMax,
+                QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+                [&](double val) {
+                    if (!wnad)
+                        return;
+                    wnad->SetRange(wnad->GetRange().first, val);
+                    glView->update();
+                });
+        connect(ui->comboBoxColormap,
+                QOverload<int>::of(&QComboBox::currentIndexChanged),
+                [&](int idx) {
+                    renderer->SetColormap(static_cast<Colormap>(idx));
+                    glView->update();
+                });
         connect(ui->radioButtonViewWireFrame, &QRadioButton::clicked,
                 [&](bool checked) {
                     renderer->SetDrawWireFrame(checked);
@@ -258,6 +326,11 @@ class MainWindow : public QWidget {
                     renderer->SetNeuronHalfWidth(val);
                     glView->update();
                 });
+        connect(ui->spinBoxTrailLen,
+                QOverload<int>::of(&QSpinBox::valueChanged), [&](int val) {
+                    renderer->SetTrailLength(val);
+                    glView->update();
+                });
         connect(ui->comboBoxSceneMode,
                 QOverload<int>::of(&QComboBox::currentIndexChanged),
                 [&](int idx) {
@@ -269,10 +342,61 @@ class MainWindow : public QWidget {
                 });
         connect(ui->horizontalSliderTiemStep, &QSlider::valueChanged,
                 [&](int val) {
+                    // dragged by user rather than set by playTimer
+                    if (val != playback.GetTimeStep())
+                        playback.Seek(val);
                     renderer->SetTimeStep(val);
                     ui->labelTimeStep->setText(QString::number(val));
+                    if (ui->checkBoxGrid->isChecked())
+                        syncGridTimeSteps();
                     glView->update();
                 });
+        playTimer.setTimerType(Qt::PreciseTimer);
+        connect(&playTimer, &QTimer::timeout, [&]() {
+            ui->horizontalSliderTiemStep->setValue(playback.Advance());
+            renderer->SetTime(playback.GetTime());
+            // repaint every tick, since the slider only changes on whole
+            // time steps, and frames in between are interpolated
+            glView->update();
+            ui->labelDroppedFrames->setText(
+                QString("Dropped Frames: %1 / %2")
+                    .arg(playback.GetDroppedFrameNum())
+                    .arg(playback.GetPresentedFrameNum()));
+            if (!playback.IsPlaying())
+                ui->pushButtonPlay->setChecked(false);
+        });
+        connect(ui->pushButtonPlay, &QPushButton::toggled, [&](bool checked) {
+            if (checked) {
+                playback.Play();
+                playTimer.start(frameIntervalMS());
+            } else {
+                playback.Pause();
+                playTimer.stop();
+            }
+            ui->pushButtonPlay->setText(checked ? "Pause" : "Play");
+        });
+        connect(ui->spinBoxTargetFPS,
+                QOverload<int>::of(&QSpinBox::valueChanged), [&](int val) {
+                    playback.SetTargetFPS(val);
+                    playTimer.setInterval(frameIntervalMS());
+                });
+        connect(ui->doubleSpinBoxPlaySpeed,
+                QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+                [&](double val) { playback.SetSpeed(val); });
+        connect(ui->checkBoxLoop, &QCheckBox::toggled,
+                [&](bool checked) { playback.SetLoop(checked); });
+        connect(ui->checkBoxGrid, &QCheckBox::toggled, [&]() {
+            syncGridTimeSteps();
+            glView->update();
+        });
+        for (auto spinBox : {ui->spinBoxGridNum, ui->spinBoxGridStride})
+            connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+                    [&]() {
+                        if (!ui->checkBoxGrid->isChecked())
+                            return;
+                        syncGridTimeSteps();
+                        glView->update();
+                    });
         connect(ui->doubleSpinBoxAmbientStrength,
                 QOverload<double>::of(&QDoubleSpinBox::valueChanged),
                 [&](double val) {
@@ -377,14 +501,71 @@ class MainWindow : public QWidget {
                 else
                     camera.move(+MOV_SENSITY, 0, 0);
                 break;
+            case Qt::Key_I:
+                if (wnpd)
+                    if (auto octr = wnpd->PinRawDatOctree(); octr)
+                        std::cout << "Neuron octree stats:\n"
+                                  << octr->GetStats() << std::endl;
+                break;
+            case Qt::Key_P: {
+                auto &profiler = renderer->GetProfiler();
+                profiler.SetEnabled(!profiler.IsEnabled(),
+                                    std::string(PROJECT_BINARY_DIR) +
+                                        "/frame_profile.csv");
+                break;
+            }
+            case Qt::Key_L: {
+                renderer->SetNeuronLOD(!renderer->IsNeuronLODEnabled());
+                auto &cnts = renderer->GetNeuronLODCounts();
+                std::cout << "Neuron LOD "
+                          << (renderer->IsNeuronLODEnabled() ? "on" : "off")
+                          << ", last frame full/coarse/impostor: " << cnts[0]
+                          << '/' << cnts[1] << '/' << cnts[2] << std::endl;
+                break;
+            }
+            case Qt::Key_C: {
+                renderer->SetNeuronCulling(
+                    !renderer->IsNeuronCullingEnabled());
+                auto &cnts = renderer->GetNeuronLODCounts();
+                std::cout << "Neuron culling "
+                          << (renderer->IsNeuronCullingEnabled() ? "on"
+                                                                  : "off")
+                          << ", last frame drawn: "
+                          << cnts[0] + cnts[1] + cnts[2] << std::endl;
+                break;
+            }
+            case Qt::Key_BracketLeft:
+                renderer->SetNeuronDivisionNum(
+                    renderer->GetNeuronDivisionNum() - 4);
+                break;
+            case Qt::Key_BracketRight:
+                renderer->SetNeuronDivisionNum(
+                    renderer->GetNeuronDivisionNum() + 4);
+                break;
             }
             glView->GLResized(glView->width(), glView->height());
             glView->update();
         });
         connect(glView, &GLView::MousePressed, [&](const glm::vec2 &normPos) {
-            if (!isSelectingInliers)
+            if (isSelectingInliers) {
+                inliersSelectFrame[0] = normPos;
+                return;
+            }
+            if (!wnpd || renderer->GetRenderTarget() !=
+                             WormRenderer::RenderTarget::NeuronReg)
                 return;
-            inliersSelectFrame[0] = normPos;
+
+            auto [R, F, U, P] = camera.getRFUP();
+            glm::mat3 cameraRot{R.x, R.y, R.z, U.x, U.y, U.z, -F.x, -F.y, -F.z};
+            glm::vec3 drc = unProj * glm::vec4{2.f * normPos.x - 1.f,
+                                               2.f * normPos.y - 1.f, 1.f, 1.f};
+            drc = wnpdModelRevRot * cameraRot * drc;
+            glm::vec3 org = wnpdModelRev * glm::vec4{P, 1.f};
+
+            glView->makeCurrent();
+            renderer->SetPickedNeuron(wnpd->PickNeuron(
+                org, drc, ui->doubleSpinBoxNuroHfWid->value()));
+            glView->update();
         });
         connect(glView, &GLView::MouseMoved, [&](const glm::vec2 &normPos) {
             if (!isSelectingInliers)
@@ -446,6 +627,32 @@ class MainWindow : public QWidget {
     }
 
   private:
+    inline int frameIntervalMS() const {
+        return static_cast<int>(
+            std::round(1000.0 * playback.GetFrameInterval().count()));
+    }
+    /// <summary>
+    /// Grid cells start from the current time step, stepping by stride
+    /// </summary>
+    void syncGridTimeSteps() {
+        std::vector<size_t> timeSteps;
+        if (ui->checkBoxGrid->isChecked()) {
+            size_t timeStep = ui->horizontalSliderTiemStep->value();
+            size_t maxTimeStep = ui->horizontalSliderTiemStep->maximum();
+            size_t stride = ui->spinBoxGridStride->value();
+            for (int k = 0; k < ui->spinBoxGridNum->value() &&
+                            timeStep <= maxTimeStep;
+                 ++k, timeStep += stride)
+                timeSteps.emplace_back(timeStep);
+        }
+        renderer->SetGridTimeSteps(std::move(timeSteps));
+    }
+    void resetActivity() {
+        wnad.reset();
+        renderer->SetWormNeuronActivityDat(nullptr);
+        playback.SetPrefetcher({}, PlaybackController::DEFAULT_PREFETCH_NUM);
+        ui->labelActivityPath->clear();
+    }
     inline void syncFromRenderPamram() {
         ui->radioButtonViewWireFrame->clicked(
             ui->radioButtonViewWireFrame->isChecked());
@@ -453,8 +660,11 @@ class MainWindow : public QWidget {
             ui->doubleSpinBoxFrontFaceOpacity->value());
         ui->doubleSpinBoxNuroHfWid->valueChanged(
             ui->doubleSpinBoxNuroHfWid->value());
+        ui->spinBoxTrailLen->valueChanged(ui->spinBoxTrailLen->value());
         ui->comboBoxSceneMode->setCurrentIndex(
             ui->comboBoxSceneMode->currentIndex());
+        ui->comboBoxColormap->currentIndexChanged(
+            ui->comboBoxColormap->currentIndex());
     }
     inline void syncFromLightParam() {
         std::array arrs{
@@ -0,0 +1,259 @@
+#ifndef KOUEK_OFFSCREEN_RECORDER_H
+#define KOUEK_OFFSCREEN_RECORDER_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "image_write.h"
+#include "worm_renderer.hpp"
+
+namespace kouek {
+/// <summary>
+/// Render a range of time steps into an FBO and save them as an image
+/// sequence, without any window.
+/// Frames are read back through a ring of PBOs, thus glReadPixels() of
+/// frame i only queues a copy, which is mapped pboNum frames later while
+/// the GPU keeps rendering. Mapped pixels are handed to encoder threads,
+/// so PNG/PPM encoding and disk writes overlap rendering as well.
+/// </summary>
+class OffscreenRecorder {
+  public:
+    static constexpr uint8_t DEFAULT_PBO_NUM = 3;
+    enum class ImageFormat : uint8_t { PNG, PPM };
+
+  private:
+    static constexpr GLint CHANNEL_NUM = 4;
+    static constexpr GLuint64 WAIT_TIMEOUT_NS = 1000000000;
+    /// <summary>
+    /// Bound memory of frames waiting for encoders
+    /// </summary>
+    static constexpr size_t MAX_JOB_NUM_PER_ENCODER = 2;
+
+    struct Slot {
+        GLuint PBO;
+        GLsync fence = nullptr;
+        size_t timeStep;
+    };
+    struct EncodeJob {
+        std::string path;
+        std::vector<uint8_t> pixels;
+    };
+
+    GLsizei width, height;
+    GLuint FBO, colorRBO, depthRBO;
+    ImageFormat format = ImageFormat::PNG;
+    std::vector<Slot> slots;
+
+    std::vector<std::thread> encoders;
+    std::mutex jobMtx;
+    std::condition_variable jobCV, doneCV;
+    std::queue<EncodeJob> jobs;
+    size_t busyEncoderNum = 0;
+    bool stopEncoders = false;
+
+  public:
+    /// <summary>
+    /// encoderNum == 0 uses all hardware threads but one, which renders
+    /// </summary>
+    OffscreenRecorder(GLsizei width, GLsizei height,
+                      uint8_t pboNum = DEFAULT_PBO_NUM,
+                      uint32_t encoderNum = 0)
+        : width(width), height(height),
+          slots(std::max(pboNum, (uint8_t)1)) {
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenRenderbuffers(1, &colorRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER, colorRBO);
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width,
+                              height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, depthRBO);
+        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("Offscreen framebuffer is incomplete");
+
+        for (auto &slot : slots) {
+            glGenBuffers(1, &slot.PBO);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+            glBufferData(GL_PIXEL_PACK_BUFFER, getFrameSize(), nullptr,
+                         GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (encoderNum == 0)
+            encoderNum = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        encoders.reserve(encoderNum);
+        for (uint32_t i = 0; i < encoderNum; ++i)
+            encoders.emplace_back([this]() { encode(); });
+    }
+    ~OffscreenRecorder() {
+        {
+            std::lock_guard lk(jobMtx);
+            stopEncoders = true;
+        }
+        jobCV.notify_all();
+        for (auto &encoder : encoders)
+            encoder.join();
+
+        for (auto &slot : slots) {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.PBO);
+        }
+        glDeleteRenderbuffers(1, &colorRBO);
+        glDeleteRenderbuffers(1, &depthRBO);
+        glDeleteFramebuffers(1, &FBO);
+    }
+    OffscreenRecorder(const OffscreenRecorder &) = delete;
+    OffscreenRecorder &operator=(const OffscreenRecorder &) = delete;
+    inline void SetImageFormat(ImageFormat format) { this->format = format; }
+    inline auto GetImageFormat() const { return format; }
+    /// <summary>
+    /// Render time steps in [beg, end) into outDir as frame_<timeStep>.png
+    /// (or .ppm). Return after every frame is written.
+    /// Camera, light and render target of renderer are used as is.
+    /// </summary>
+    void Record(WormRenderer &renderer, size_t beg, size_t end,
+                const std::string &outDir) {
+        std::filesystem::create_directories(outDir);
+
+        GLint prevFBO;
+        std::array<GLint, 4> prevViewport;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+        glGetIntegerv(GL_VIEWPORT, prevViewport.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        size_t slotIdx = 0;
+        for (auto timeStep = beg; timeStep < end; ++timeStep) {
+            auto &slot = slots[slotIdx];
+            if (slot.fence)
+                drain(slot, outDir);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.SetTimeStep(timeStep);
+            renderer.Render();
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                         (void *)0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            slot.timeStep = timeStep;
+
+            slotIdx = (slotIdx + 1) % slots.size();
+        }
+        // drain in the order of issue
+        for (size_t i = 0; i < slots.size(); ++i) {
+            auto &slot = slots[(slotIdx + i) % slots.size()];
+            if (slot.fence)
+                drain(slot, outDir);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2],
+                   prevViewport[3]);
+
+        std::unique_lock lk(jobMtx);
+        doneCV.wait(lk, [&]() { return jobs.empty() && busyEncoderNum == 0; });
+    }
+
+  private:
+    inline size_t getFrameSize() const {
+        return (size_t)width * height * CHANNEL_NUM;
+    }
+    /// <summary>
+    /// Wait for the readback of slot, then copy the pixels out of its PBO
+    /// and queue them for encoding
+    /// </summary>
+    void drain(Slot &slot, const std::string &outDir) {
+        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                WAIT_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        EncodeJob job;
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06zu.%s", slot.timeStep,
+                          format == ImageFormat::PNG ? "png" : "ppm");
+            job.path = (std::filesystem::path(outDir) / name).string();
+        }
+        job.pixels.resize(getFrameSize());
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        auto mapped =
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, getFrameSize(),
+                             GL_MAP_READ_BIT);
+        if (mapped) {
+            std::copy_n(static_cast<const uint8_t *>(mapped), getFrameSize(),
+                        job.pixels.data());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!mapped)
+            return;
+
+        {
+            std::unique_lock lk(jobMtx);
+            doneCV.wait(lk, [&]() {
+                return jobs.size() < MAX_JOB_NUM_PER_ENCODER * encoders.size();
+            });
+            jobs.emplace(std::move(job));
+        }
+        jobCV.notify_one();
+    }
+    void encode() {
+        while (true) {
+            EncodeJob job;
+            {
+                std::unique_lock lk(jobMtx);
+                jobCV.wait(lk, [&]() { return stopEncoders || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+                ++busyEncoderNum;
+            }
+            doneCV.notify_all();
+
+            auto written =
+                format == ImageFormat::PNG
+                    ? WriteRawToPNG(job.path, job.pixels.data(), width, height,
+                                    CHANNEL_NUM)
+                    : WriteRawToPPM(job.path, job.pixels.data(), width, height,
+                                    CHANNEL_NUM);
+            if (!written)
+                std::cout << "Cannot write frame: " << job.path << std::endl;
+
+            {
+                std::lock_guard lk(jobMtx);
+                --busyEncoderNum;
+            }
+            doneCV.notify_all();
+        }
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_OFFSCREEN_RECORDER_H
@@ -0,0 +1,204 @@
+#ifndef KOUEK_PLAYBACK_CONTROLLER_H
+#define KOUEK_PLAYBACK_CONTROLLER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace kouek {
+/// <summary>
+/// Timed playback of time steps, independent of any UI.
+/// Time advances by wall-clock time passed between Advance() calls, at
+/// targetFPS * speed time steps per second, thus late ticks are caught up
+/// instead of slowing playback down. A tick arriving later than 1.5 frame
+/// intervals counts the frames it skipped as dropped.
+/// The next prefetchNum time steps are handed to the prefetcher on a
+/// worker thread, e.g. to page in data streamed from disk before it is
+/// displayed.
+/// </summary>
+class PlaybackController {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Prefetcher = std::function<void(size_t timeStep)>;
+    static constexpr float DEFAULT_TARGET_FPS = 30.f;
+    static constexpr size_t DEFAULT_PREFETCH_NUM = 8;
+
+  private:
+    bool playing = false, loop = true;
+    float targetFPS = DEFAULT_TARGET_FPS, speed = 1.f;
+    double time = 0;
+    size_t timeStepNum = 0;
+    size_t presentedFrameNum = 0, droppedFrameNum = 0;
+    Clock::time_point lastTick;
+
+    size_t prefetchNum = DEFAULT_PREFETCH_NUM;
+    /// <summary>
+    /// The farthest time step handed to prefetcher, or NONE
+    /// </summary>
+    size_t prefetchedTimeStep;
+    Prefetcher prefetcher;
+    std::thread prefetchWorker;
+    std::mutex prefetchMtx;
+    std::condition_variable prefetchCV;
+    std::deque<size_t> prefetchQueue;
+    bool stopPrefetch = false;
+
+  public:
+    static constexpr auto NONE = std::numeric_limits<size_t>::max();
+
+    PlaybackController() : prefetchedTimeStep(NONE) {
+        prefetchWorker = std::thread([this]() { prefetch(); });
+    }
+    ~PlaybackController() {
+        {
+            std::lock_guard lk(prefetchMtx);
+            stopPrefetch = true;
+        }
+        prefetchCV.notify_one();
+        prefetchWorker.join();
+    }
+    PlaybackController(const PlaybackController &) = delete;
+    PlaybackController &operator=(const PlaybackController &) = delete;
+    /// <summary>
+    /// Pause and rewind to time step 0
+    /// </summary>
+    void SetTimeStepNum(size_t num) {
+        timeStepNum = num;
+        Pause();
+        Seek(0);
+    }
+    inline auto GetTimeStepNum() const { return timeStepNum; }
+    void SetTargetFPS(float fps) { targetFPS = std::max(fps, 1.f); }
+    inline auto GetTargetFPS() const { return targetFPS; }
+    inline auto GetFrameInterval() const {
+        return std::chrono::duration<double>(1.0 / targetFPS);
+    }
+    void SetSpeed(float speed) { this->speed = std::max(speed, 0.f); }
+    inline auto GetSpeed() const { return speed; }
+    void SetLoop(bool loop) { this->loop = loop; }
+    inline auto GetLoop() const { return loop; }
+    /// <summary>
+    /// Called on the worker thread, should not touch GL objects
+    /// </summary>
+    void SetPrefetcher(Prefetcher prefetcher, size_t prefetchNum) {
+        std::lock_guard lk(prefetchMtx);
+        this->prefetcher = std::move(prefetcher);
+        this->prefetchNum = prefetchNum;
+        prefetchQueue.clear();
+        prefetchedTimeStep = NONE;
+    }
+
+    void Play(Clock::time_point now = Clock::now()) {
+        if (timeStepNum == 0)
+            return;
+        // replay from the beginning once reached the end
+        if (!loop && time >= timeStepNum - 1)
+            time = 0;
+        playing = true;
+        lastTick = now;
+        presentedFrameNum = droppedFrameNum = 0;
+        requestPrefetch();
+    }
+    void Pause() { playing = false; }
+    inline auto IsPlaying() const { return playing; }
+    void Seek(size_t timeStep) {
+        time = std::min(timeStep, timeStepNum == 0 ? 0 : timeStepNum - 1);
+        {
+            std::lock_guard lk(prefetchMtx);
+            prefetchQueue.clear();
+            prefetchedTimeStep = NONE;
+        }
+        if (playing)
+            requestPrefetch();
+    }
+    /// <summary>
+    /// Fractional time in [0, timeStepNum)
+    /// </summary>
+    inline auto GetTime() const { return time; }
+    inline auto GetTimeStep() const { return static_cast<size_t>(time); }
+    inline auto GetPresentedFrameNum() const { return presentedFrameNum; }
+    inline auto GetDroppedFrameNum() const { return droppedFrameNum; }
+    /// <summary>
+    /// Advance time to now, which should be called once per presented
+    /// frame. Return the time step to present.
+    /// Playback pauses at the last time step if not looping.
+    /// </summary>
+    size_t Advance(Clock::time_point now = Clock::now()) {
+        if (!playing)
+            return GetTimeStep();
+
+        auto elapsed = std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+        auto interval = GetFrameInterval().count();
+        if (elapsed > 1.5 * interval)
+            droppedFrameNum +=
+                static_cast<size_t>(std::round(elapsed / interval)) - 1;
+        ++presentedFrameNum;
+
+        time += elapsed * targetFPS * speed;
+        if (loop)
+            time = std::fmod(time, static_cast<double>(timeStepNum));
+        else if (time >= timeStepNum - 1) {
+            time = timeStepNum - 1;
+            playing = false;
+        }
+
+        requestPrefetch();
+        return GetTimeStep();
+    }
+
+  private:
+    void requestPrefetch() {
+        {
+            std::lock_guard lk(prefetchMtx);
+            if (!prefetcher || timeStepNum == 0)
+                return;
+            auto curr = GetTimeStep();
+            // offsets from curr, in (prefetched, prefetchNum]
+            auto prefetched = prefetchedTimeStep == NONE
+                                  ? 0
+                                  : (prefetchedTimeStep + timeStepNum - curr) %
+                                        timeStepNum;
+            if (prefetched > prefetchNum)
+                prefetched = 0; // fell behind, restart from curr
+            for (auto off = prefetched + 1; off <= prefetchNum; ++off) {
+                auto timeStep = curr + off;
+                if (timeStep >= timeStepNum) {
+                    if (!loop)
+                        break;
+                    timeStep %= timeStepNum;
+                }
+                prefetchQueue.push_back(timeStep);
+                prefetchedTimeStep = timeStep;
+            }
+        }
+        prefetchCV.notify_one();
+    }
+    void prefetch() {
+        while (true) {
+            size_t timeStep;
+            Prefetcher func;
+            {
+                std::unique_lock lk(prefetchMtx);
+                prefetchCV.wait(lk, [&]() {
+                    return stopPrefetch || !prefetchQueue.empty();
+                });
+                if (stopPrefetch)
+                    return;
+                timeStep = prefetchQueue.front();
+                prefetchQueue.pop_front();
+                func = prefetcher;
+            }
+            func(timeStep);
+        }
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_PLAYBACK_CONTROLLER_H
@@ -1,7 +1,10 @@
 #version 450 core
 
 uniform float z;
-uniform mat4 VP;
+
+layout(std140, binding = 0) uniform Camera {
+    mat4 VP;
+};
 
 layout(location = 0) in vec2 posIn;
 layout(location = 1) in vec2 texCoordIn;
@@ -1,22 +1,41 @@
 #version 450 core
 
 uniform vec3 color;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform float ambientStrength;
+uniform bool colorByActivity;
+// activities in [min, max] are mapped to [0, 1] of colormap
+uniform vec2 activityRange;
+uniform sampler1D colormap;
+
+layout(std140, binding = 1) uniform Light {
+    vec3 lightColor;
+    float ambientStrength;
+    vec3 lightPos;
+};
+
+// neurons are small, thus brightened to stand out
+#define AMBIENT_BOOST 0.2
 
 in vec4 posInWdSp;
 in vec4 normal;
+in float activity;
 
 out vec4 fragColor;
 
 void main() {
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient =
+        clamp(ambientStrength + AMBIENT_BOOST, 0.0, 1.0) * lightColor;
 
     vec3 norm = normalize(normal.xyz);
     vec3 lightDrc = normalize(lightPos - posInWdSp.xyz);
     float diff = max(dot(norm, lightDrc), 0.0);
     vec3 diffuse = diff * lightColor;
 
-    fragColor = vec4((ambient + diffuse) * color, 1.0);
+    vec3 baseColor = color;
+    if (colorByActivity) {
+        float t = (activity - activityRange.x) /
+                  max(activityRange.y - activityRange.x, 1e-6);
+        baseColor = texture(colormap, clamp(t, 0.0, 1.0)).rgb;
+    }
+
+    fragColor = vec4((ambient + diffuse) * baseColor, 1.0);
 }
@@ -1,11 +1,96 @@
 #version 450 core
 
-layout(location = 0) in vec3 posIn;
+uniform float halfWid;
+uniform int nuroOffs;
+uniform int nextNuroOffs;
+uniform float timeFrac;
+uniform int idxOffs;
+uniform bool indexed;
+// in grid mode, instance i is neuron i % gridNuroNum of cell i / gridNuroNum
+uniform bool grid;
+uniform int gridNuroNum;
+// activities of neurons, float[2][actNuroNum] holding the current and the
+// next time steps, interpolated by timeFrac
+uniform bool colorByActivity;
+uniform int actNuroNum;
+uniform samplerBuffer activities;
 
-out VertDat {
-    vec3 cntrPos;
-} vs_out;
+layout(std140, binding = 0) uniform Camera {
+    mat4 VP;
+};
+layout(std140, binding = 2) uniform Model {
+    mat4 M;
+};
+
+// vertex of unit sphere, which is also its normal
+layout(location = 0) in vec3 sphPosIn;
+
+// packed vec3 of neurons, instance i is placed at neuron
+// nuroOffs + (indexed ? nuroIdxs[idxOffs + i] : i),
+// moving towards the same neuron offset by nextNuroOffs by timeFrac
+layout(std430, binding = 0) readonly buffer NeuronPositions {
+    float nuroPoss[];
+};
+layout(std430, binding = 1) readonly buffer NeuronIndices {
+    uint nuroIdxs[];
+};
+
+// the same as in worm3D.vs
+struct GridCell {
+    vec2 posOffs;
+    vec2 ndcOffs;
+    float ndcScale;
+    uint timeStep;
+};
+layout(std430, binding = 2) readonly buffer GridCells {
+    GridCell cells[];
+};
+
+out vec4 posInWdSp;
+out vec4 normal;
+out float activity;
+out float gl_ClipDistance[4];
+
+vec3 loadPos(int idx) {
+    return vec3(nuroPoss[3 * idx], nuroPoss[3 * idx + 1],
+                nuroPoss[3 * idx + 2]);
+}
+
+void placeInCell(GridCell cell) {
+    gl_Position.xy =
+        cell.ndcScale * gl_Position.xy + cell.ndcOffs * gl_Position.w;
+    vec2 lo = (cell.ndcOffs - cell.ndcScale) * gl_Position.w;
+    vec2 hi = (cell.ndcOffs + cell.ndcScale) * gl_Position.w;
+    gl_ClipDistance[0] = gl_Position.x - lo.x;
+    gl_ClipDistance[1] = hi.x - gl_Position.x;
+    gl_ClipDistance[2] = gl_Position.y - lo.y;
+    gl_ClipDistance[3] = hi.y - gl_Position.y;
+}
 
 void main() {
-    vs_out.cntrPos = posIn;
+    vec3 cntrPos;
+    GridCell cell;
+    activity = 0;
+    if (grid) {
+        cell = cells[gl_InstanceID / gridNuroNum];
+        int idx = nuroOffs + int(cell.timeStep) * gridNuroNum +
+                  gl_InstanceID % gridNuroNum;
+        cntrPos = loadPos(idx);
+        cntrPos.xy += cell.posOffs;
+    } else {
+        int inst =
+            indexed ? int(nuroIdxs[idxOffs + gl_InstanceID]) : gl_InstanceID;
+        cntrPos = mix(loadPos(nuroOffs + inst), loadPos(nextNuroOffs + inst),
+                      timeFrac);
+        if (colorByActivity)
+            activity = mix(texelFetch(activities, inst).r,
+                           texelFetch(activities, actNuroNum + inst).r,
+                           timeFrac);
+    }
+
+    posInWdSp = M * vec4(cntrPos + halfWid * sphPosIn, 1.0);
+    gl_Position = VP * posInWdSp;
+    normal = M * vec4(sphPosIn, 0);
+    if (grid)
+        placeInCell(cell);
 }
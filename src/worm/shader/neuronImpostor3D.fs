@@ -0,0 +1,50 @@
+#version 450 core
+
+uniform vec3 color;
+// rotation from view space to world space
+uniform mat3 viewRotInv;
+// the same as in neuron3D.fs
+uniform bool colorByActivity;
+uniform vec2 activityRange;
+uniform sampler1D colormap;
+
+layout(std140, binding = 1) uniform Light {
+    vec3 lightColor;
+    float ambientStrength;
+    vec3 lightPos;
+};
+
+#define AMBIENT_BOOST 0.2
+
+in vec3 cntrInWdSp;
+in float radiusInWdSp;
+in float activity;
+
+out vec4 fragColor;
+
+void main() {
+    // the front hemisphere of the sphere seen through the sprite
+    vec2 xy = 2.0 * gl_PointCoord - 1.0;
+    xy.y = -xy.y;
+    float rr = dot(xy, xy);
+    if (rr > 1.0)
+        discard;
+    vec3 norm = normalize(viewRotInv * vec3(xy, sqrt(1.0 - rr)));
+    vec3 posInWdSp = cntrInWdSp + radiusInWdSp * norm;
+
+    vec3 ambient =
+        clamp(ambientStrength + AMBIENT_BOOST, 0.0, 1.0) * lightColor;
+
+    vec3 lightDrc = normalize(lightPos - posInWdSp);
+    float diff = max(dot(norm, lightDrc), 0.0);
+    vec3 diffuse = diff * lightColor;
+
+    vec3 baseColor = color;
+    if (colorByActivity) {
+        float t = (activity - activityRange.x) /
+                  max(activityRange.y - activityRange.x, 1e-6);
+        baseColor = texture(colormap, clamp(t, 0.0, 1.0)).rgb;
+    }
+
+    fragColor = vec4((ambient + diffuse) * baseColor, 1.0);
+}
@@ -0,0 +1,54 @@
+#version 450 core
+
+uniform float halfWid;
+uniform int nuroOffs;
+uniform int nextNuroOffs;
+uniform float timeFrac;
+uniform int idxOffs;
+// pixels covered by a unit length at view depth 1
+uniform float pxPerUnit;
+// the same as in neuron3D.vs
+uniform bool colorByActivity;
+uniform int actNuroNum;
+uniform samplerBuffer activities;
+
+layout(std140, binding = 0) uniform Camera {
+    mat4 VP;
+};
+layout(std140, binding = 2) uniform Model {
+    mat4 M;
+};
+
+// vertex i is a point sprite of neuron nuroOffs + nuroIdxs[idxOffs + i]
+layout(std430, binding = 0) readonly buffer NeuronPositions {
+    float nuroPoss[];
+};
+layout(std430, binding = 1) readonly buffer NeuronIndices {
+    uint nuroIdxs[];
+};
+
+out vec3 cntrInWdSp;
+out float radiusInWdSp;
+out float activity;
+
+vec3 loadPos(int idx) {
+    return vec3(nuroPoss[3 * idx], nuroPoss[3 * idx + 1],
+                nuroPoss[3 * idx + 2]);
+}
+
+void main() {
+    int inst = int(nuroIdxs[idxOffs + gl_VertexID]);
+    vec3 cntrPos = mix(loadPos(nuroOffs + inst), loadPos(nextNuroOffs + inst),
+                       timeFrac);
+
+    vec4 cntr = M * vec4(cntrPos, 1.0);
+    cntrInWdSp = cntr.xyz;
+    radiusInWdSp = halfWid * length(M[0].xyz);
+    gl_Position = VP * cntr;
+    gl_PointSize = max(2.0 * radiusInWdSp * pxPerUnit / gl_Position.w, 1.0);
+
+    activity = 0;
+    if (colorByActivity)
+        activity = mix(texelFetch(activities, inst).r,
+                       texelFetch(activities, actNuroNum + inst).r, timeFrac);
+}
@@ -0,0 +1,11 @@
+#version 450 core
+
+uniform vec3 color;
+
+in float age;
+
+out vec4 fragColor;
+
+void main() {
+    fragColor = vec4(color, 1.0 - age);
+}
@@ -0,0 +1,45 @@
+#version 450 core
+
+uniform int nuroNum;
+// vertex i of instance n is neuron n at time step firstTimeStep + i,
+// the vertex after currTimeStep is the head moving towards nextTimeStep
+uniform int firstTimeStep;
+uniform int currTimeStep;
+uniform int nextTimeStep;
+uniform float timeFrac;
+uniform float trailLen;
+
+layout(std140, binding = 0) uniform Camera {
+    mat4 VP;
+};
+layout(std140, binding = 2) uniform Model {
+    mat4 M;
+};
+
+// packed vec3 of neurons, time-major
+layout(std430, binding = 0) readonly buffer NeuronPositions {
+    float nuroPoss[];
+};
+
+// in [0, 1], 0 at the head
+out float age;
+
+vec3 loadPos(int timeStep) {
+    int idx = timeStep * nuroNum + gl_InstanceID;
+    return vec3(nuroPoss[3 * idx], nuroPoss[3 * idx + 1],
+                nuroPoss[3 * idx + 2]);
+}
+
+void main() {
+    int timeStep = firstTimeStep + gl_VertexID;
+    vec3 pos;
+    if (timeStep > currTimeStep) {
+        pos = mix(loadPos(currTimeStep), loadPos(nextTimeStep), timeFrac);
+        age = 0;
+    } else {
+        pos = loadPos(timeStep);
+        age = clamp((currTimeStep + timeFrac - timeStep) / trailLen, 0, 1);
+    }
+
+    gl_Position = VP * M * vec4(pos, 1.0);
+}
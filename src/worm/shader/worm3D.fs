@@ -1,9 +1,12 @@
 #version 450 core
 
 uniform vec3 color;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform float ambientStrength;
+
+layout(std140, binding = 1) uniform Light {
+    vec3 lightColor;
+    float ambientStrength;
+    vec3 lightPos;
+};
 
 in vec4 posInWdSp;
 in vec4 normal;
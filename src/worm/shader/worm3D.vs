@@ -1,17 +1,61 @@
 #version 450 core
 
-layout(location = 0) in vec3 cntrPosIn;
-layout(location = 1) in vec3 deltaIn;
+uniform bool reverseNormal;
+uniform float timeFrac;
+uniform bool grid;
 
-out VertDat {
-    vec3 cntrPos;
-    vec3 delta;
-    int isFirstLastOrNot;
-} vs_out;
+layout(std140, binding = 0) uniform Camera {
+    mat4 VP;
+};
+layout(std140, binding = 2) uniform Model {
+    mat4 M;
+};
+
+layout(location = 0) in vec3 posIn;
+layout(location = 1) in vec3 normalIn;
+// the same vertex at the next time step
+layout(location = 2) in vec3 nextPosIn;
+layout(location = 3) in vec3 nextNormalIn;
+// in grid mode, the cell of this instance
+layout(location = 4) in uint cellIdxIn;
+
+// posOffs moves the worm of timeStep to the origin of model space,
+// the whole view is then squeezed into the square of half size ndcScale
+// centered at ndcOffs in NDC
+struct GridCell {
+    vec2 posOffs;
+    vec2 ndcOffs;
+    float ndcScale;
+    uint timeStep;
+};
+layout(std430, binding = 2) readonly buffer GridCells {
+    GridCell cells[];
+};
+
+out vec4 posInWdSp;
+out vec4 normal;
+out float gl_ClipDistance[4];
+
+void placeInCell(GridCell cell) {
+    gl_Position.xy =
+        cell.ndcScale * gl_Position.xy + cell.ndcOffs * gl_Position.w;
+    vec2 lo = (cell.ndcOffs - cell.ndcScale) * gl_Position.w;
+    vec2 hi = (cell.ndcOffs + cell.ndcScale) * gl_Position.w;
+    gl_ClipDistance[0] = gl_Position.x - lo.x;
+    gl_ClipDistance[1] = hi.x - gl_Position.x;
+    gl_ClipDistance[2] = gl_Position.y - lo.y;
+    gl_ClipDistance[3] = hi.y - gl_Position.y;
+}
 
 void main() {
-    vs_out.cntrPos = vec3(cntrPosIn.xy, 0);
-    vs_out.delta = deltaIn;
-    vs_out.isFirstLastOrNot = cntrPosIn.z == -1.0 ? -1
-        : (cntrPosIn.z == 1.0 ? 1 : 0);
+    vec3 pos = mix(posIn, nextPosIn, timeFrac);
+    vec3 nrm = mix(normalIn, nextNormalIn, timeFrac);
+    if (grid)
+        pos.xy += cells[cellIdxIn].posOffs;
+
+    posInWdSp = M * vec4(pos, 1.0);
+    gl_Position = VP * posInWdSp;
+    normal = M * vec4(reverseNormal ? -nrm : nrm, 0);
+    if (grid)
+        placeInCell(cells[cellIdxIn]);
 }
@@ -0,0 +1,137 @@
+#ifndef KOUEK_SPHERE_MESH_H
+#define KOUEK_SPHERE_MESH_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace kouek {
+/// <summary>
+/// Unit UV sphere, whose vertex positions are also their normals.
+/// divNum is the number of divisions along yaw, and half of it is the number
+/// of divisions along pitch. Drawn with instancing, one instance per neuron.
+/// </summary>
+class SphereMesh {
+  public:
+    static constexpr uint8_t MIN_DIV_NUM = 4;
+    static constexpr uint8_t MAX_DIV_NUM = 128;
+
+  private:
+    uint8_t divNum = 0;
+    GLsizei idxCnt = 0;
+    GLuint VAO, VBO, EBO;
+
+  public:
+    SphereMesh(uint8_t divNum) {
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                              (const void *)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        SetDivisionNum(divNum);
+    }
+    ~SphereMesh() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+    SphereMesh(const SphereMesh &) = delete;
+    SphereMesh &operator=(const SphereMesh &) = delete;
+    inline auto GetDivisionNum() const { return divNum; }
+    inline auto GetIndexCnt() const { return idxCnt; }
+    /// <summary>
+    /// Rebuild the mesh if divNum changes.
+    /// divNum is clamped to [MIN_DIV_NUM, MAX_DIV_NUM] and rounded to even.
+    /// </summary>
+    void SetDivisionNum(uint8_t divNum) {
+        divNum = static_cast<uint8_t>(
+            std::clamp(divNum, MIN_DIV_NUM, MAX_DIV_NUM) & ~0x1);
+        if (this->divNum == divNum)
+            return;
+        this->divNum = divNum;
+
+        // rings from the bottom pole (pDiv = 0) to the top pole
+        // (pDiv = pDivNum), where poles are single vertices
+        uint8_t pDivNum = divNum / 2;
+        std::vector<glm::vec3> verts;
+        verts.reserve(2 + (pDivNum - 1) * divNum);
+        verts.emplace_back(0, -1.f, 0);
+        for (uint8_t pDiv = 1; pDiv < pDivNum; ++pDiv) {
+            auto p = glm::pi<float>() * ((float)pDiv / pDivNum - .5f);
+            for (uint8_t yDiv = 0; yDiv < divNum; ++yDiv) {
+                auto y = glm::pi<float>() * 2.f * yDiv / divNum;
+                verts.emplace_back(+cosf(p) * cosf(y), +sinf(p),
+                                   -cosf(p) * sinf(y));
+            }
+        }
+        verts.emplace_back(0, +1.f, 0);
+
+        auto vertIdx = [&](uint8_t pDiv, uint8_t yDiv) -> GLushort {
+            if (pDiv == 0)
+                return 0;
+            if (pDiv == pDivNum)
+                return verts.size() - 1;
+            return 1 + (pDiv - 1) * divNum + yDiv % divNum;
+        };
+        // quad (lo, yaw), (lo, yaw+1), (hi, yaw+1), (hi, yaw) is split into
+        // 2 counter-clockwise triangles seen from outside
+        std::vector<GLushort> indices;
+        indices.reserve(6 * divNum * (pDivNum - 1));
+        for (uint8_t pDiv = 0; pDiv < pDivNum; ++pDiv)
+            for (uint8_t yDiv = 0; yDiv < divNum; ++yDiv) {
+                auto a = vertIdx(pDiv, yDiv), b = vertIdx(pDiv, yDiv + 1);
+                auto c = vertIdx(pDiv + 1, yDiv + 1),
+                     d = vertIdx(pDiv + 1, yDiv);
+                if (pDiv != 0)
+                    indices.insert(indices.end(), {a, b, c});
+                if (pDiv != pDivNum - 1)
+                    indices.insert(indices.end(), {a, c, d});
+            }
+        idxCnt = indices.size();
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * verts.size(),
+                     verts.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * idxCnt,
+                     indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    /// <summary>
+    /// Draw instNum spheres. The bound shader places each instance by
+    /// gl_InstanceID.
+    /// </summary>
+    inline void DrawInstanced(GLsizei instNum) const {
+        if (instNum == 0)
+            return;
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, idxCnt, GL_UNSIGNED_SHORT, 0,
+                                instNum);
+        glBindVertexArray(0);
+    }
+    /// <summary>
+    /// Draw by the DrawElementsIndirectCommand at cmdOffs of the bound
+    /// GL_DRAW_INDIRECT_BUFFER, whose count should be GetIndexCnt()
+    /// </summary>
+    inline void DrawIndirect(size_t cmdOffs) const {
+        glBindVertexArray(VAO);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                               reinterpret_cast<const void *>(cmdOffs));
+        glBindVertexArray(0);
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_SPHERE_MESH_H
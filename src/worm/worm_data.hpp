@@ -16,6 +16,8 @@
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <util/trace.hpp>
+
 namespace kouek {
 class WormPositionData {
   public:
@@ -42,6 +44,7 @@ class WormPositionData {
         static void
         Parse(std::vector<std::vector<std::array<glm::vec3, 2>>> &dat,
               const std::string &filePath) {
+            KOUEK_TRACE_SCOPE("load", "ParseWormPosition");
             using namespace std;
 
             ifstream in(filePath.data(), ios::ate | ifstream::binary);
@@ -132,11 +135,10 @@ class WormPositionData {
         }
     };
 
-    GLuint VAO, VBO;
-    std::array<GLuint, 3> componentVAOs;
-    std::array<GLuint, 3> componentEBOs;
-    std::array<std::array<GLuint, 2>, 3> componentStartEnds;
-    std::array<GLuint, 3> componentVertCnts{0};
+    /// <summary>
+    /// Vertex range [start, end) of each component, see SetComponentRatio()
+    /// </summary>
+    std::array<std::array<GLuint, 2>, 3> componentStartEnds{};
     glm::vec2 maxPos{-std::numeric_limits<float>::infinity()},
         minPos{std::numeric_limits<float>::infinity()};
     std::string filePath;
@@ -154,6 +156,7 @@ class WormPositionData {
 
   public:
     WormPositionData(const std::string_view filePath) : filePath(filePath) {
+        KOUEK_TRACE_SCOPE("load", "WormPositionData");
         // extract data from contour file
         {
             std::vector<std::vector<std::array<glm::vec3, 2>>> dat;
@@ -196,97 +199,25 @@ class WormPositionData {
                     cntrPath.emplace(cntrPos.x, vertsT.size() - 1);
                 }
             }
-            // label the z component of the center position
-            // of the first and the last vertex with -1.0 and 1,0,
-            // in order to inform the shader
-            for (auto &vertsT : verts) {
-                vertsT.front().cntrPos.z = -1.f;
-                vertsT.back().cntrPos.z = 1.f;
-            }
-        }
-
-        glGenBuffers(1, &VBO);
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexDat),
-                              (const void *)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexDat),
-                              (const void *)sizeof(glm::vec3));
-        size_t vertCnt = verts.front().size();
-        size_t timeCnt = verts.size();
-        glBufferData(GL_ARRAY_BUFFER, sizeof(VertexDat) * vertCnt * timeCnt,
-                     nullptr, GL_STATIC_DRAW);
-        for (size_t t = 0; t < timeCnt; ++t)
-            glBufferSubData(GL_ARRAY_BUFFER,
-                            sizeof(VertexDat) * vertCnt * t,
-                            sizeof(VertexDat) * vertCnt, verts[t].data());
-        // unlabel the first and last vertex
-        for (auto &vertsT : verts) {
-            vertsT.front().cntrPos.z = 0;
-            vertsT.back().cntrPos.z = 0;
-        }
-
-        glGenVertexArrays(3, componentVAOs.data());
-        glGenBuffers(3, componentEBOs.data());
-        for (uint8_t idx = 0; idx < 3; ++idx) {
-            glBindVertexArray(componentVAOs[idx]);
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexDat),
-                                  (const void *)0);
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexDat),
-                                  (const void *)sizeof(glm::vec3));
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, componentEBOs[idx]);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * vertCnt,
-                         nullptr, GL_STATIC_DRAW);
         }
-
-        glBindVertexArray(0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-    ~WormPositionData() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteVertexArrays(3, componentVAOs.data());
-        glDeleteBuffers(3, componentEBOs.data());
     }
+    /// <summary>
+    /// Set the vertex range of component by ratios of the vertex count,
+    /// e.g. drawn through WormTubeMesh::DrawRange()
+    /// </summary>
     void SetComponentRatio(Component component, float startRatio,
                            float endRatio) {
-        std::vector<GLuint> componentIndices;
         auto vertCnt = verts.front().size();
         auto cmpIdx = static_cast<uint8_t>(component);
         GLuint lft = vertCnt * startRatio;
         GLuint rht = vertCnt * endRatio;
         if (lft > rht || lft > vertCnt || rht > vertCnt)
             return;
-        componentVertCnts[cmpIdx] = rht - lft;
         componentStartEnds[cmpIdx][0] = lft;
         componentStartEnds[cmpIdx][1] = rht;
-        if (lft == rht)
-            return;
-        componentIndices.reserve(componentVertCnts[cmpIdx]);
-        for (auto idx = lft; idx < rht; ++idx)
-            componentIndices.emplace_back(idx);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, componentEBOs[cmpIdx]);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-                        sizeof(GLuint) * componentIndices.size(),
-                        componentIndices.data());
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     inline const auto &GetVerts() const { return verts; }
     inline const auto &GetCntrPath() const { return cntrPath; }
-    inline const auto GetVAO() { return VAO; }
-    inline const auto GetComponentVAO(Component component) const {
-        return componentVAOs[static_cast<uint8_t>(component)];
-    }
-    inline const auto GetComponentVertCnt(Component component) const {
-        return componentVertCnts[static_cast<uint8_t>(component)];
-    }
     inline const auto GetComponentStartEnd(Component component) const {
         return componentStartEnds[static_cast<uint8_t>(component)];
     }
@@ -0,0 +1,147 @@
+#ifndef KOUEK_WORM_NEURON_ACTIVITY_DATA_H
+#define KOUEK_WORM_NEURON_ACTIVITY_DATA_H
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <util/mapped_file.hpp>
+#include <util/trace.hpp>
+
+namespace kouek {
+/// <summary>
+/// One scalar per neuron per time step, e.g. calcium imaging signals,
+/// read from a raw binary file of float[timeCnt][nuroNum] whose neurons
+/// are ordered as in WormNeuronPositionData.
+/// The file is memory-mapped, and only rows of time steps being displayed
+/// and a bounded sample of rows for the range are touched, thus files
+/// larger than memory are fine. Rows of the displayed time step and the
+/// next one are streamed into a texture buffer of R32F, see Upload().
+/// </summary>
+class WormNeuronActivityData {
+  public:
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    /// <summary>
+    /// Max number of rows read to compute the initial range
+    /// </summary>
+    static constexpr size_t RANGE_SAMPLE_NUM = 256;
+
+  private:
+    size_t nuroNum, timeCnt;
+    size_t uploadedTimeStep = NONE, uploadedNextTimeStep = NONE;
+    float minVal, maxVal;
+    std::shared_ptr<MappedFile> file;
+    GLuint TBO, tex;
+
+  public:
+    WormNeuronActivityData(const std::string &filePath, size_t nuroNum)
+        : nuroNum(nuroNum), file(std::make_shared<MappedFile>(filePath)) {
+        KOUEK_TRACE_SCOPE("load", "WormNeuronActivityData");
+        auto rowSize = sizeof(float) * nuroNum;
+        if (nuroNum == 0 || file->GetSize() == 0 ||
+            file->GetSize() % rowSize != 0)
+            throw std::runtime_error(
+                "Size of activity file should be a multiple of " +
+                std::to_string(nuroNum) + " floats: " + filePath);
+        timeCnt = file->GetSize() / rowSize;
+
+        sampleRange();
+
+        glGenBuffers(1, &TBO);
+        glBindBuffer(GL_TEXTURE_BUFFER, TBO);
+        glBufferData(GL_TEXTURE_BUFFER, 2 * rowSize, nullptr,
+                     GL_STREAM_DRAW);
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_BUFFER, tex);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, TBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+    ~WormNeuronActivityData() {
+        glDeleteTextures(1, &tex);
+        glDeleteBuffers(1, &TBO);
+    }
+    WormNeuronActivityData(const WormNeuronActivityData &) = delete;
+    WormNeuronActivityData &
+    operator=(const WormNeuronActivityData &) = delete;
+    inline auto GetNeuronNum() const { return nuroNum; }
+    inline auto GetTimeCount() const { return timeCnt; }
+    /// <summary>
+    /// Range of values mapped onto the colormap. Initially the range of at
+    /// most RANGE_SAMPLE_NUM rows evenly strided over all time steps, thus
+    /// fixed for a file regardless of playback
+    /// </summary>
+    inline auto GetRange() const { return std::make_pair(minVal, maxVal); }
+    void SetRange(float min, float max) {
+        minVal = min;
+        maxVal = max;
+    }
+    /// <summary>
+    /// Texture buffer of float[2][nuroNum], holding rows uploaded by the
+    /// last Upload()
+    /// </summary>
+    inline auto GetTex() const { return tex; }
+    /// <summary>
+    /// Stream rows of timeStep and nextTimeStep into texture buffer,
+    /// skipped if they are already there
+    /// </summary>
+    void Upload(size_t timeStep, size_t nextTimeStep) {
+        timeStep = std::min(timeStep, timeCnt - 1);
+        nextTimeStep = std::min(nextTimeStep, timeCnt - 1);
+        if (timeStep == uploadedTimeStep &&
+            nextTimeStep == uploadedNextTimeStep)
+            return;
+
+        auto rowSize = sizeof(float) * nuroNum;
+        glBindBuffer(GL_TEXTURE_BUFFER, TBO);
+        // orphan the storage still being read by previous frames
+        glBufferData(GL_TEXTURE_BUFFER, 2 * rowSize, nullptr,
+                     GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, rowSize, getRow(timeStep));
+        glBufferSubData(GL_TEXTURE_BUFFER, rowSize, rowSize,
+                        getRow(nextTimeStep));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        uploadedTimeStep = timeStep;
+        uploadedNextTimeStep = nextTimeStep;
+    }
+    /// <summary>
+    /// Return a function paging in the row of a time step without blocking,
+    /// e.g. as the prefetcher of PlaybackController. It is thread safe and
+    /// keeps the mapping alive by itself, thus may outlive this.
+    /// </summary>
+    std::function<void(size_t)> GetPrefetcher() const {
+        return [file = file, rowSize = sizeof(float) * nuroNum,
+                timeCnt = timeCnt](size_t timeStep) {
+            if (timeStep < timeCnt)
+                file->Prefetch(rowSize * timeStep, rowSize);
+        };
+    }
+
+  private:
+    void sampleRange() {
+        minVal = std::numeric_limits<float>::max();
+        maxVal = std::numeric_limits<float>::lowest();
+        auto sampleNum = std::min(timeCnt, RANGE_SAMPLE_NUM);
+        for (size_t k = 0; k < sampleNum; ++k) {
+            // always include the first and the last time step
+            auto timeStep =
+                sampleNum == 1 ? 0 : k * (timeCnt - 1) / (sampleNum - 1);
+            auto vals = getRow(timeStep);
+            auto [minItr, maxItr] = std::minmax_element(vals, vals + nuroNum);
+            minVal = std::min(minVal, *minItr);
+            maxVal = std::max(maxVal, *maxItr);
+        }
+    }
+    inline const float *getRow(size_t timeStep) const {
+        return reinterpret_cast<const float *>(file->GetData()) +
+               nuroNum * timeStep;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_WORM_NEURON_ACTIVITY_DATA_H
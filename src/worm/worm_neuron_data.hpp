@@ -3,9 +3,14 @@
 
 #include "worm_data.hpp"
 
+#include <thread>
 #include <unordered_set>
 
 #include <util/math.h>
+#include <util/point_octree.hpp>
+#include <util/rcu_index.hpp>
+#include <util/trace.hpp>
+#include <util/trajectory_index.hpp>
 
 #include <Eigen/Dense>
 
@@ -14,6 +19,7 @@ namespace kouek {
 class WormNeuronPositionData {
   public:
     static constexpr uint8_t CURVE_SAMPLE_MULT = 10;
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
 
   private:
     class Parser {
@@ -23,6 +29,7 @@ class WormNeuronPositionData {
       public:
         static void Parse(std::vector<glm::vec3> &dat,
                           const std::string &filePath) {
+            KOUEK_TRACE_SCOPE("load", "ParseNeuronPosition");
             using namespace std;
 
             ifstream in(filePath.data(), ios::ate | ifstream::binary);
@@ -90,9 +97,7 @@ class WormNeuronPositionData {
         }
     };
 
-    GLuint VAO, VBO;
-    GLuint inliersVAO, inliersEBO;
-    GLuint curveVAO, curveVBO;
+    GLuint VBO = 0, inliersEBO = 0, curveVBO = 0;
     size_t wormVertCnt;
     glm::vec3 maxPos{-std::numeric_limits<GLfloat>::infinity()},
         minPos{std::numeric_limits<GLfloat>::infinity()};
@@ -103,6 +108,14 @@ class WormNeuronPositionData {
     std::vector<glm::vec3> curve;
     std::unordered_set<size_t> inliers;
     std::array<std::unordered_set<size_t>, 3> cmpInliers;
+    /// <summary>
+    /// Built in background by idxBuilder, so picking and culling are
+    /// available once they are published. trajIdx is rebuilt whenever
+    /// verts change.
+    /// </summary>
+    mutable RCUIndex<PointOctree<uint32_t>> rawDatOctr;
+    mutable RCUIndex<TrajectoryIndex> trajIdx;
+    std::thread idxBuilder;
 
     std::shared_ptr<WormPositionData> wpd;
 
@@ -110,6 +123,7 @@ class WormNeuronPositionData {
     WormNeuronPositionData(std::string_view filePath,
                            std::shared_ptr<WormPositionData> wpd)
         : filePath(filePath), wpd(wpd) {
+        KOUEK_TRACE_SCOPE("load", "WormNeuronPositionData");
         Parser::Parse(rawDat, this->filePath);
         for (const auto &pos : rawDat) {
             for (uint8_t xyz = 0; xyz < 3; ++xyz) {
@@ -121,59 +135,45 @@ class WormNeuronPositionData {
         }
 
         if (rawDat.empty() || wpd->GetVerts().empty() ||
-            wpd->GetVerts().front().empty())
+            wpd->GetVerts().front().empty()) {
+            buildIndices(true);
             return;
+        }
         wormVertCnt = wpd->GetVerts().front().size();
         size_t nuroVertCnt = rawDat.size();
         size_t timeCnt = wpd->GetVerts().size();
 
+        KOUEK_TRACE_SCOPE("upload", "UploadNeuronPosition");
         glGenBuffers(1, &VBO);
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                              (const void *)0);
         glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * nuroVertCnt * timeCnt,
                      nullptr, GL_STATIC_DRAW);
 
-        glGenBuffers(1, &inliersEBO);
-        glGenVertexArrays(1, &inliersVAO);
-        glBindVertexArray(inliersVAO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                              (const void *)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, inliersEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * nuroVertCnt,
-                     nullptr, GL_STATIC_DRAW);
-
         glGenBuffers(1, &curveVBO);
-        glGenVertexArrays(1, &curveVAO);
-        glBindVertexArray(curveVAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ARRAY_BUFFER, curveVBO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                              (const void *)0);
         glBufferData(GL_ARRAY_BUFFER,
                      sizeof(glm::vec3) * wormVertCnt * CURVE_SAMPLE_MULT,
                      nullptr, GL_STATIC_DRAW);
-
-        glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &inliersEBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, inliersEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * nuroVertCnt,
+                     nullptr, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         assignRawDatToVerts();
+        buildIndices(true);
     }
     ~WormNeuronPositionData() {
-        glDeleteVertexArrays(1, &VAO);
+        if (idxBuilder.joinable())
+            idxBuilder.join();
         glDeleteBuffers(1, &VBO);
-        glDeleteVertexArrays(1, &inliersVAO);
         glDeleteBuffers(1, &inliersEBO);
-        glDeleteVertexArrays(1, &curveVAO);
         glDeleteBuffers(1, &curveVBO);
     }
     void PolyCurveFitWith(uint8_t order) {
+        KOUEK_TRACE_SCOPE("fit", "PolyCurveFitWith");
         if (rawDat.empty() || wpd->GetVerts().empty() ||
             wpd->GetVerts().front().empty())
             return;
@@ -208,12 +208,19 @@ class WormNeuronPositionData {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         assignRawDatToVerts();
+        buildIndices(false);
     }
     void SelectAndAppendComponentInliers(WormPositionData::Component component,
                                          const Frustum &frustm) {
         auto cmpIdx = static_cast<uint8_t>(component);
-        for (size_t rdIdx = 0; rdIdx < rawDat.size(); ++rdIdx)
-            if (frustm.IsIntersetcedWith(rawDat[rdIdx])) {
+        std::vector<uint64_t> mask(Frustum::GetMaskWordNum(rawDat.size()));
+        frustm.IsIntersetcedWith(rawDat.data(), rawDat.size(), mask.data());
+        for (size_t wordIdx = 0; wordIdx < mask.size(); ++wordIdx)
+            for (uint64_t rdIdx = wordIdx * Frustum::MASK_BIT_NUM,
+                          word = mask[wordIdx];
+                 word != 0; ++rdIdx, word >>= 1) {
+                if ((word & 0x1) == 0)
+                    continue;
                 bool exist = false;
                 for (uint8_t idx = 0; idx < 3; ++idx)
                     if (idx != cmpIdx && cmpInliers[idx].count(rdIdx) != 0) {
@@ -227,6 +234,24 @@ class WormNeuronPositionData {
             }
         uploadCmpInliers();
     }
+    /// <summary>
+    /// Return index of the nearest neuron in raw data whose sphere of
+    /// hfWid is hit by the ray, or NONE.
+    /// org and drc are in the space of raw data.
+    /// </summary>
+    inline size_t PickNeuron(const glm::vec3 &org, const glm::vec3 &drc,
+                             float hfWid) const {
+        auto octr = rawDatOctr.Pin();
+        if (!octr)
+            return NONE;
+        auto [node, datIdx, t] =
+            octr->QueryRay(org, glm::normalize(drc), hfWid);
+        return node ? node->dat[datIdx].second : NONE;
+    }
+    /// <summary>
+    /// Falsy until the background build is published
+    /// </summary>
+    inline auto PinRawDatOctree() const { return rawDatOctr.Pin(); }
     inline void UnselectComponent(WormPositionData::Component component) {
         auto cmpIdx = static_cast<uint8_t>(component);
         for (const auto val : cmpInliers[cmpIdx])
@@ -236,12 +261,16 @@ class WormNeuronPositionData {
     }
     inline void ClearCurve() { curve.clear(); }
     void RegisterWithWPD() {
+        KOUEK_TRACE_SCOPE("register", "RegisterWithWPD");
         if (curve.empty() || rawDat.empty() || wpd->GetVerts().empty() ||
             wpd->GetVerts().front().empty())
             return;
 
+        invalidateTrajectoryIndex();
         registerWithWPD();
+        buildIndices(false);
 
+        KOUEK_TRACE_SCOPE("upload", "UploadRegisteredNeurons");
         size_t nuroVertCnt = rawDat.size();
         size_t timeCnt = wpd->GetVerts().size();
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -252,23 +281,71 @@ class WormNeuronPositionData {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
     inline const auto &GetVerts() const { return verts; }
-    inline const auto GetVAO() const { return VAO; }
-    inline const auto GetInliersVAO() const { return inliersVAO; }
+    /// <summary>
+    /// Falsy until the background build over the current verts is
+    /// published
+    /// </summary>
+    inline auto PinTrajectoryIndex() const { return trajIdx.Pin(); }
+    inline const auto GetVBO() const { return VBO; }
+    inline const auto GetInliersEBO() const { return inliersEBO; }
     inline const auto
     GetComponentInliersVertCnt(WormPositionData::Component component) const {
         return cmpInliers[static_cast<uint8_t>(component)].size();
     }
-    inline const auto GetCurveVAO() const { return curveVAO; }
+    inline const auto GetCurveVBO() const { return curveVBO; }
     inline const auto GetCurveVertCnt() const { return curve.size(); }
     inline const auto GetPosRange() const {
         return std::make_tuple(minPos, maxPos);
     }
 
   private:
+    /// <summary>
+    /// Start building trajIdx over verts in background, after rawDatOctr if
+    /// withRawDatOctr. The builder is (re)started only once verts are final,
+    /// i.e. at the end of the constructor, PolyCurveFitWith() and
+    /// RegisterWithWPD(), and it reads verts, thus verts should only change
+    /// after invalidateTrajectoryIndex(). The constructor calls it last for
+    /// exception safety, since a joinable thread must not be destroyed by an
+    /// exception thrown before the destructor can join it.
+    /// </summary>
+    void buildIndices(bool withRawDatOctr) {
+        std::vector<std::pair<glm::vec3, uint32_t>> dat;
+        if (withRawDatOctr) {
+            dat.reserve(rawDat.size());
+            for (uint32_t rdIdx = 0; rdIdx < rawDat.size(); ++rdIdx)
+                dat.emplace_back(rawDat[rdIdx], rdIdx);
+        }
+        auto withTrajIdx = !verts.empty() && !verts.front().empty();
+        if (dat.empty() && !withTrajIdx)
+            return;
+        if (idxBuilder.joinable())
+            idxBuilder.join();
+        idxBuilder = std::thread([this, min = minPos, max = maxPos,
+                                  dat = std::move(dat), withTrajIdx]() mutable {
+            if (!dat.empty()) {
+                KOUEK_TRACE_SCOPE("index", "BuildNeuronOctree");
+                rawDatOctr.Emplace(min, max, std::move(dat));
+            }
+            if (withTrajIdx) {
+                KOUEK_TRACE_SCOPE("index", "BuildTrajectoryIndex");
+                trajIdx.Emplace(verts);
+            }
+        });
+    }
+    /// <summary>
+    /// Wait for the builder and withdraw trajIdx, before verts change
+    /// </summary>
+    void invalidateTrajectoryIndex() {
+        if (idxBuilder.joinable())
+            idxBuilder.join();
+        trajIdx.Publish(nullptr);
+    }
     void assignRawDatToVerts() {
+        KOUEK_TRACE_SCOPE("upload", "AssignRawDatToVerts");
         size_t nuroVertCnt = rawDat.size();
         size_t timeCnt = wpd->GetVerts().size();
 
+        invalidateTrajectoryIndex();
         verts.resize(timeCnt);
         verts.front().clear();
         for (const auto &pos : rawDat)
@@ -283,6 +360,7 @@ class WormNeuronPositionData {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
     inline void uploadCmpInliers() {
+        KOUEK_TRACE_SCOPE("upload", "UploadInliers");
         std::vector<GLuint> plainInliers;
         plainInliers.reserve(inliers.size());
         for (uint8_t cmpIdx = 0; cmpIdx < 3; ++cmpIdx) {
@@ -1,15 +1,28 @@
 #ifndef KOUEK_WORM_RENDERER_H
 #define KOUEK_WORM_RENDERER_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
 #include <memory>
 #include <vector>
 
 #include <cmake_in.h>
 
+#include <util/frame_profiler.hpp>
+#include <util/math.h>
 #include <util/shader.h>
+#include <util/trace.hpp>
+#include <util/uniform_buffer.hpp>
 
+#include "colormap.hpp"
+#include "sphere_mesh.hpp"
 #include "worm_data.hpp"
+#include "worm_neuron_activity_data.hpp"
 #include "worm_neuron_data.hpp"
+#include "worm_tube_mesh.hpp"
 
 #include "image_read.h"
 
@@ -27,6 +40,10 @@ namespace kouek {
 
 class WormRenderer {
   public:
+    static constexpr uint8_t DEFAULT_NURO_DIV_NUM = 12;
+    static constexpr uint8_t COARSE_NURO_DIV_NUM = 6;
+    static constexpr float DEFAULT_NURO_LOD_FULL_MIN_PX = 8.f;
+    static constexpr float DEFAULT_NURO_LOD_COARSE_MIN_PX = 2.f;
     enum class SceneMode : uint8_t { Full, Focus };
     enum class RenderTarget : uint8_t {
         Worm,
@@ -41,24 +58,131 @@ class WormRenderer {
     };
 
   private:
-    bool cameraChanged = true, divNumChanged = true, lightChanged = true;
+    /// <summary>
+    /// std140 uniform blocks shared by programs, whose bindings match
+    /// the layout(binding = ...) in shaders
+    /// </summary>
+    struct CameraBlock {
+        glm::mat4 VP;
+    };
+    struct LightBlock {
+        glm::vec3 lightColor;
+        float ambientStrength;
+        glm::vec3 lightPos;
+        float pad0;
+    };
+    static_assert(offsetof(LightBlock, ambientStrength) == 12 &&
+                  offsetof(LightBlock, lightPos) == 16);
+    struct ModelBlock {
+        glm::mat4 M;
+    };
+    /// <summary>
+    /// std430 element of the grid cell storage buffer, see worm3D.vs
+    /// </summary>
+    struct GridCell {
+        glm::vec2 posOffs;
+        glm::vec2 ndcOffs;
+        float ndcScale;
+        GLuint timeStep;
+    };
+    static_assert(sizeof(GridCell) == 24 && offsetof(GridCell, ndcScale) == 16);
+    /// <summary>
+    /// Indirect commands of neuron LODs, see selectNeuronLODs()
+    /// </summary>
+    struct NeuronDrawCommands {
+        struct {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        } full, coarse;
+        struct {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseInstance;
+        } impostor;
+    };
+    /// <summary>
+    /// Passes timed by profiler, see frame_profiler.hpp
+    /// </summary>
+    enum ProfiledPass : uint8_t {
+        BackgroundPass,
+        BackFacePass,
+        FrontFacePass,
+        NeuronPass,
+        InlierPass,
+        CurvePass,
+        ComponentPass,
+        TrailPass
+    };
+    static constexpr GLuint CAMERA_BINDING = 0;
+    static constexpr GLuint LIGHT_BINDING = 1;
+    static constexpr GLuint MODEL_BINDING = 2;
+    static constexpr GLuint GRID_CELL_BINDING = 2;
+    static constexpr GLuint ACTIVITY_TEX_UNIT = 1;
+    static constexpr GLuint COLORMAP_TEX_UNIT = 2;
+    static constexpr GLsizei COLORMAP_SAMPLE_NUM = 256;
+    static constexpr size_t NO_CMD = std::numeric_limits<size_t>::max();
+    static constexpr glm::vec3 WORM_BACK_COLOR{.4f, .6f, .1f};
+    static constexpr glm::vec3 WORM_FRONT_COLOR{.6f, .6f, .4f};
+    static constexpr glm::vec3 NURO_COLOR{.4f, .8f, 1.f};
+    static constexpr glm::vec3 TRAIL_COLOR{1.f, .8f, .3f};
+
+    bool cameraChanged = true, wormMeshChanged = true, lightChanged = true;
+    bool nuroDivNumChanged = true;
     bool sceneModeChanged = true, timeStepChanged = true,
          renderTargetChanged = true;
+    bool gridChanged = false, colormapChanged = true;
+    bool nuroLOD = true, nuroCulling = true;
     bool drawWireFrame = false;
-    uint8_t divNum;
+    uint8_t divNum, nuroDivNum = DEFAULT_NURO_DIV_NUM;
     GLuint backgroundVAO, backgroundVBO, backgroundEBO, backgroundTex;
     GLuint frameVAO, frameVBO, frameEBO;
-    size_t wormVertCnt, nuroVertCnt, curveVertCnt;
+    GLuint gridCellSSBO;
+    GLuint emptyVAO;
+    GLuint colormapTex;
+    GLuint nuroLODIdxBuf, nuroLODCmdBuf;
+    size_t nuroVertCnt, curveVertCnt;
     size_t timeStep = 0;
+    size_t trailLen = 0;
+    /// <summary>
+    /// Fraction in [0, 1) of the way from timeStep to the next one
+    /// </summary>
+    GLfloat timeFrac = 0;
+    size_t pickedNuroIdx = WormNeuronPositionData::NONE;
+    std::vector<size_t> gridTimeSteps;
     GLfloat nuroHfWid = .01f, frontFaceOpacity = 1.f;
+    GLfloat nuroLODFullMinPx = DEFAULT_NURO_LOD_FULL_MIN_PX;
+    GLfloat nuroLODCoarseMinPx = DEFAULT_NURO_LOD_COARSE_MIN_PX;
+    /// <summary>
+    /// Visible neurons in full, coarse and impostor LODs, whose indices are
+    /// packed one LOD after another in nuroLODIdxs, see selectNeuronLODs()
+    /// </summary>
+    std::array<GLsizei, 3> nuroLODCnts{};
+    std::vector<GLuint> nuroLODIdxs;
+    std::vector<uint32_t> nuroVisIdxs;
+    std::vector<uint8_t> nuroLODs;
     GLfloat backgroundZ, minScaleThroughT, avgScaleThroughT;
     glm::mat4 view, proj;
+    glm::mat4 model{1.f};
     LightParam lightParam;
     SceneMode sceneMode = SceneMode::Full;
     RenderTarget renderTarget = RenderTarget::Worm;
-    std::unique_ptr<Shader> wormShader, nuroShader, bkgrndShader, normalShader;
+    Colormap colormap = Colormap::Viridis;
+    std::unique_ptr<Shader> wormShader, nuroShader, bkgrndShader, normalShader,
+        trailShader, impostorShader;
+    std::unique_ptr<SphereMesh> nuroMesh, coarseNuroMesh;
+    std::unique_ptr<WormTubeMesh> wormMesh;
+    std::unique_ptr<UniformBuffer<CameraBlock>> cameraUBO;
+    std::unique_ptr<UniformBuffer<LightBlock>> lightUBO;
+    std::unique_ptr<UniformBuffer<ModelBlock>> modelUBO;
     std::shared_ptr<WormPositionData> wpd;
     std::shared_ptr<WormNeuronPositionData> wnpd;
+    std::shared_ptr<WormNeuronActivityData> wnad;
+    FrameProfiler profiler{{"Background", "BackFace", "FrontFace", "Neuron",
+                            "Inlier", "Curve", "Component", "Trail"}};
 
   public:
     WormRenderer() {
@@ -130,40 +254,51 @@ class WormRenderer {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        wormShader =
-            std::make_unique<Shader>((std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/worm3D.vs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/worm3D.fs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/worm3D.gs")
-                                         .c_str());
-        nuroShader =
-            std::make_unique<Shader>((std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/neuron3D.vs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/neuron3D.fs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/neuron3D.gs")
-                                         .c_str());
-        bkgrndShader =
-            std::make_unique<Shader>((std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/background3D.vs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/background3D.fs")
-                                         .c_str());
-        normalShader =
-            std::make_unique<Shader>((std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/normal3D.vs")
-                                         .c_str(),
-                                     (std::string(kouek::PROJECT_SOURCE_DIR) +
-                                      "/src/worm/shader/normal3D.fs")
-                                         .c_str());
+        glGenBuffers(1, &gridCellSSBO);
+        // for draws fetching everything from storage buffers
+        glGenVertexArrays(1, &emptyVAO);
+        glGenBuffers(1, &nuroLODIdxBuf);
+        glGenBuffers(1, &nuroLODCmdBuf);
+
+        glGenTextures(1, &colormapTex);
+        glBindTexture(GL_TEXTURE_1D, colormapTex);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_1D, 0);
+
+        {
+            auto shaderDir =
+                std::string(kouek::PROJECT_SOURCE_DIR) + "/src/worm/shader/";
+            auto shaderCacheDir =
+                std::string(kouek::PROJECT_BINARY_DIR) + "/shader_cache";
+            auto loadShader = [&](const char *name) {
+                return std::make_unique<Shader>(
+                    (shaderDir + name + ".vs").c_str(),
+                    (shaderDir + name + ".fs").c_str(), nullptr,
+                    shaderCacheDir.c_str());
+            };
+            // compare startup time with and without a warm cache
+            KOUEK_TRACE_SCOPE("load", "LoadShaderPrograms");
+            wormShader = loadShader("worm3D");
+            nuroShader = loadShader("neuron3D");
+            bkgrndShader = loadShader("background3D");
+            normalShader = loadShader("normal3D");
+            trailShader = loadShader("trail3D");
+            impostorShader = loadShader("neuronImpostor3D");
+        }
+        nuroMesh = std::make_unique<SphereMesh>(nuroDivNum);
+        coarseNuroMesh = std::make_unique<SphereMesh>(COARSE_NURO_DIV_NUM);
+        cameraUBO =
+            std::make_unique<UniformBuffer<CameraBlock>>(CAMERA_BINDING);
+        lightUBO = std::make_unique<UniformBuffer<LightBlock>>(LIGHT_BINDING);
+        modelUBO = std::make_unique<UniformBuffer<ModelBlock>>(MODEL_BINDING);
+        nuroShader->use();
+        nuroShader->setInt("activities", ACTIVITY_TEX_UNIT);
+        nuroShader->setInt("colormap", COLORMAP_TEX_UNIT);
+        impostorShader->use();
+        impostorShader->setInt("activities", ACTIVITY_TEX_UNIT);
+        impostorShader->setInt("colormap", COLORMAP_TEX_UNIT);
         normalShader->use();
         normalShader->setMat4("M", glm::identity<glm::mat4>());
         normalShader->setMat4("VP", glm::identity<glm::mat4>());
@@ -175,9 +310,25 @@ class WormRenderer {
         glDeleteVertexArrays(1, &frameVAO);
         glDeleteBuffers(1, &frameVBO);
         glDeleteBuffers(1, &frameEBO);
+        glDeleteBuffers(1, &gridCellSSBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteTextures(1, &colormapTex);
+        glDeleteBuffers(1, &nuroLODIdxBuf);
+        glDeleteBuffers(1, &nuroLODCmdBuf);
     }
     void SetTimeStep(size_t timeStep) {
         this->timeStep = timeStep;
+        timeFrac = 0;
+        timeStepChanged = true;
+    }
+    /// <summary>
+    /// Fractional time step. Positions of worm and neurons are interpolated
+    /// between 2 adjacent time steps in vertex shaders.
+    /// </summary>
+    void SetTime(double time) {
+        time = std::max(time, 0.0);
+        timeStep = static_cast<size_t>(time);
+        timeFrac = static_cast<GLfloat>(time - timeStep);
         timeStepChanged = true;
     }
     void SetDrawWireFrame(bool drawWireFrame) {
@@ -192,12 +343,32 @@ class WormRenderer {
         renderTargetChanged = true;
     }
     inline auto GetRenderTarget() const { return renderTarget; }
+    /// <summary>
+    /// Draw timeSteps side by side in a grid of square cells, each centered
+    /// on the worm of its time step, for RenderTarget::Worm and
+    /// RenderTarget::WormAndNeuron. Worm and neurons of all cells are drawn
+    /// by one draw call each, thus CPU cost does not grow with cells.
+    /// Empty timeSteps leaves the grid mode.
+    /// </summary>
+    void SetGridTimeSteps(std::vector<size_t> timeSteps) {
+        gridTimeSteps = std::move(timeSteps);
+        gridChanged = sceneModeChanged = true;
+    }
+    inline const auto &GetGridTimeSteps() const { return gridTimeSteps; }
+    /// <summary>
+    /// Draw the paths of registered neurons through the last trailLen time
+    /// steps, fading out with age, for RenderTarget::WormAndNeuron.
+    /// 0 disables trails.
+    /// </summary>
+    void SetTrailLength(size_t trailLen) { this->trailLen = trailLen; }
+    inline auto GetTrailLength() const { return trailLen; }
     void SetWormPositionDat(std::shared_ptr<WormPositionData> dat) {
         wpd = dat;
         wnpd.reset();
+        wormMesh.reset();
+        wormMeshChanged = gridChanged = true;
         if (!dat)
             return;
-        wormVertCnt = wpd->GetVerts().front().size();
         {
             backgroundZ = 0;
             for (const auto &vertsT : wpd->GetVerts())
@@ -222,14 +393,66 @@ class WormRenderer {
     }
     void SetWormNeuronPositionDat(std::shared_ptr<WormNeuronPositionData> dat) {
         wnpd = dat;
+        wnad.reset();
+        pickedNuroIdx = WormNeuronPositionData::NONE;
         if (!dat)
             return;
         nuroVertCnt = wnpd->GetVerts().front().size();
     }
+    /// <summary>
+    /// Color registered neurons by their activities through colormap in
+    /// RenderTarget::WormAndNeuron, out of grid mode. Ignored unless it has
+    /// as many neurons as the neuron position data. Set nullptr to color
+    /// them uniformly.
+    /// </summary>
+    void SetWormNeuronActivityDat(std::shared_ptr<WormNeuronActivityData> dat) {
+        wnad = dat;
+    }
+    void SetColormap(Colormap colormap) {
+        this->colormap = colormap;
+        colormapChanged = true;
+    }
+    inline auto GetColormap() const { return colormap; }
     void SetDivisionNum(uint8_t divNum) {
         this->divNum = divNum;
-        divNumChanged = true;
+        wormMeshChanged = true;
     }
+    /// <summary>
+    /// Tessellation level of neuron spheres, clamped to
+    /// [SphereMesh::MIN_DIV_NUM, SphereMesh::MAX_DIV_NUM], see SphereMesh
+    /// </summary>
+    void SetNeuronDivisionNum(int divNum) {
+        nuroDivNum = std::clamp(divNum, int(SphereMesh::MIN_DIV_NUM),
+                                int(SphereMesh::MAX_DIV_NUM));
+        nuroDivNumChanged = true;
+    }
+    inline auto GetNeuronDivisionNum() const { return nuroDivNum; }
+    /// <summary>
+    /// Level of detail of neurons, selected per frame by projected radius.
+    /// Neurons covering at least fullMinPx pixels in radius are drawn with
+    /// full spheres, at least coarseMinPx with coarse spheres, and the rest
+    /// with point-sprite impostors shaded as spheres. If disabled, all are
+    /// drawn with full spheres.
+    /// </summary>
+    void SetNeuronLOD(bool enabled,
+                      float fullMinPx = DEFAULT_NURO_LOD_FULL_MIN_PX,
+                      float coarseMinPx = DEFAULT_NURO_LOD_COARSE_MIN_PX) {
+        nuroLOD = enabled;
+        nuroLODFullMinPx = std::max(fullMinPx, coarseMinPx);
+        nuroLODCoarseMinPx = coarseMinPx;
+    }
+    inline auto IsNeuronLODEnabled() const { return nuroLOD; }
+    /// <summary>
+    /// Skip neurons outside the view frustum, found through the trajectory
+    /// index of the neuron position data every frame
+    /// </summary>
+    void SetNeuronCulling(bool enabled) { nuroCulling = enabled; }
+    inline auto IsNeuronCullingEnabled() const { return nuroCulling; }
+    /// <summary>
+    /// Neurons drawn in full, coarse and impostor LODs in the last frame,
+    /// whose sum is the number of neurons passing culling
+    /// </summary>
+    inline const auto &GetNeuronLODCounts() const { return nuroLODCnts; }
     void SetCamera(const glm::mat4 &view, const glm::mat4 &proj) {
         this->view = view;
         this->proj = proj;
@@ -240,50 +463,56 @@ class WormRenderer {
         lightChanged = true;
     }
     const auto &GetLightParam() const { return lightParam; }
+    /// <summary>
+    /// Disabled by default, enable it to time passes of Render()
+    /// </summary>
+    inline auto &GetProfiler() { return profiler; }
+    inline const auto &GetProfiler() const { return profiler; }
     void Render() {
-        static constexpr glm::vec3 WORM_BACK_COLOR{.4f, .6f, .1f};
-        static constexpr glm::vec3 WORM_FRONT_COLOR{.6f, .6f, .4f};
-        static constexpr glm::vec3 NURO_COLOR{.4f, .8f, 1.f};
+        KOUEK_TRACE_SCOPE("render", "Render");
         static constexpr glm::vec3 SLCT_COLOR{1.f, .1f, .3f};
         static constexpr std::array<glm::vec3, 3> CMP_COLORS{
             glm::vec3{1.f, 0, 0}, glm::vec3{1.f, 0, 1.f}, glm::vec3{0, 1.f, 0}};
 
-        if (divNumChanged) {
-            std::vector<GLfloat> vals(divNum);
+        profiler.BeginFrame();
 
-            wormShader->use();
-            glUniform1ui(glGetUniformLocation(wormShader->ID, "divNum"),
-                         (GLuint)divNum);
-            for (uint8_t idx = 0; idx < divNum; ++idx)
-                vals[idx] = cosf(glm::pi<float>() * 2.f * idx / divNum);
-            glUniform1fv(glGetUniformLocation(wormShader->ID, "coss"), divNum,
-                         vals.data());
-            for (uint8_t idx = 0; idx < divNum; ++idx)
-                vals[idx] = sinf(glm::pi<float>() * 2.f * idx / divNum);
-            glUniform1fv(glGetUniformLocation(wormShader->ID, "sins"), divNum,
-                         vals.data());
-
-            auto nuroDivNum = 12; // limited by geometry shader
-            vals.resize(nuroDivNum);
-            nuroShader->use();
-            glUniform1ui(glGetUniformLocation(nuroShader->ID, "divNum"),
-                         (GLuint)nuroDivNum);
-            for (uint8_t idx = 0; idx < nuroDivNum; ++idx)
-                vals[idx] = cosf(glm::pi<float>() * 2.f * idx / nuroDivNum);
-            glUniform1fv(glGetUniformLocation(nuroShader->ID, "coss"),
-                         nuroDivNum, vals.data());
-            for (uint8_t idx = 0; idx < nuroDivNum; ++idx)
-                vals[idx] = sinf(glm::pi<float>() * 2.f * idx / nuroDivNum);
-            glUniform1fv(glGetUniformLocation(nuroShader->ID, "sins"),
-                         nuroDivNum, vals.data());
-
-            divNumChanged = false;
+        if (wormMeshChanged && wpd) {
+            wormMesh = std::make_unique<WormTubeMesh>(*wpd, divNum);
+            wormMeshChanged = false;
+            gridChanged = true;
         }
+        if (colormapChanged) {
+            auto colors = SampleColormap(colormap, COLORMAP_SAMPLE_NUM);
+            glBindTexture(GL_TEXTURE_1D, colormapTex);
+            glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, COLORMAP_SAMPLE_NUM, 0,
+                         GL_RGB, GL_FLOAT, colors.data());
+            glBindTexture(GL_TEXTURE_1D, 0);
+            colormapChanged = false;
+        }
+        if (gridChanged && wpd && !gridTimeSteps.empty()) {
+            uploadGridCells();
+            gridChanged = false;
+        }
+        if (nuroDivNumChanged) {
+            nuroMesh->SetDivisionNum(nuroDivNum);
+            nuroDivNum = nuroMesh->GetDivisionNum();
+            nuroDivNumChanged = false;
+        }
+
+        // the time step interpolated towards, clamped to the last one
+        auto nextTimeStep =
+            wpd ? std::min(timeStep + 1, wpd->GetVerts().size() - 1)
+                : timeStep;
 
         if (sceneModeChanged || renderTargetChanged || timeStepChanged) {
             sceneModeChanged = renderTargetChanged = timeStepChanged = false;
 
-            if (sceneMode == SceneMode::Full) {
+            if (inGridMode()) {
+                // cells are centered by GridCell::posOffs
+                auto M = glm::scale(glm::identity<glm::mat4>(),
+                                    glm::vec3{avgScaleThroughT});
+                uploadModel(M);
+            } else if (sceneMode == SceneMode::Full) {
                 switch (renderTarget) {
                 case RenderTarget::Worm: {
                     if (!wpd)
@@ -294,8 +523,7 @@ class WormRenderer {
                     glm::vec3 scale{2.f / std::max({delta.x, delta.y})};
                     auto M = glm::scale(glm::identity<glm::mat4>(), scale) *
                              glm::translate(glm::identity<glm::mat4>(), offset);
-                    wormShader->use();
-                    wormShader->setMat4("M", M);
+                    uploadModel(M);
                     bkgrndShader->use();
                     bkgrndShader->setFloat("z", scale.x * backgroundZ);
                     break;
@@ -310,8 +538,7 @@ class WormRenderer {
                     glm::vec3 scale{2.f / std::max({delta.x, delta.y})};
                     auto M = glm::scale(glm::identity<glm::mat4>(), scale) *
                              glm::translate(glm::identity<glm::mat4>(), offset);
-                    nuroShader->use();
-                    nuroShader->setMat4("M", M);
+                    uploadModel(M);
                     break;
                 }
                 case RenderTarget::WormReg: {
@@ -323,10 +550,7 @@ class WormRenderer {
                     glm::vec3 scale{2.f / std::max({delta.x, delta.y})};
                     auto M = glm::scale(glm::identity<glm::mat4>(), scale) *
                              glm::translate(glm::identity<glm::mat4>(), offset);
-                    wormShader->use();
-                    wormShader->setMat4("M", M);
-                    nuroShader->use();
-                    nuroShader->setMat4("M", M);
+                    uploadModel(M);
                     bkgrndShader->use();
                     bkgrndShader->setFloat("z", minScaleThroughT * backgroundZ);
                     break;
@@ -340,10 +564,7 @@ class WormRenderer {
                     glm::vec3 scale{2.f / std::max({delta.x, delta.y})};
                     auto M = glm::scale(glm::identity<glm::mat4>(), scale) *
                              glm::translate(glm::identity<glm::mat4>(), offset);
-                    wormShader->use();
-                    wormShader->setMat4("M", M);
-                    nuroShader->use();
-                    nuroShader->setMat4("M", M);
+                    uploadModel(M);
                     bkgrndShader->use();
                     bkgrndShader->setFloat("z", scale.x * backgroundZ);
                     break;
@@ -352,43 +573,26 @@ class WormRenderer {
             } else if (sceneMode == SceneMode::Focus &&
                        renderTarget != RenderTarget::NeuronReg && wpd) {
                 auto [min, max] = wpd->GetPosRangeOf(timeStep);
-                glm::vec3 offset{-.5f * (max + min), 0};
+                auto [nextMin, nextMax] = wpd->GetPosRangeOf(nextTimeStep);
+                glm::vec3 offset{-.5f * glm::mix(max + min, nextMax + nextMin,
+                                                 timeFrac),
+                                 0};
                 auto M = glm::scale(glm::identity<glm::mat4>(),
                                     glm::vec3{avgScaleThroughT}) *
                          glm::translate(glm::identity<glm::mat4>(), offset);
-                wormShader->use();
-                wormShader->setMat4("M", M);
-                nuroShader->use();
-                nuroShader->setMat4("M", M);
+                uploadModel(M);
                 bkgrndShader->use();
                 bkgrndShader->setFloat("z", minScaleThroughT * backgroundZ);
             }
         }
 
         if (cameraChanged) {
-            auto VP = proj * view;
-            wormShader->use();
-            wormShader->setMat4("VP", VP);
-            nuroShader->use();
-            nuroShader->setMat4("VP", VP);
-            bkgrndShader->use();
-            bkgrndShader->setMat4("VP", VP);
-
+            cameraUBO->Upload({proj * view});
             cameraChanged = false;
         }
         if (lightChanged) {
-            wormShader->use();
-            wormShader->setFloat("ambientStrength", lightParam.ambientStrength);
-            wormShader->setVec3("lightColor", lightParam.lightColor);
-            wormShader->setVec3("lightPos", lightParam.lightPos);
-
-            nuroShader->use();
-            nuroShader->setFloat(
-                "ambientStrength",
-                glm::clamp(lightParam.ambientStrength + .2f, 0.f, 1.f));
-            nuroShader->setVec3("lightColor", lightParam.lightColor);
-            nuroShader->setVec3("lightPos", lightParam.lightPos);
-
+            lightUBO->Upload({lightParam.lightColor, lightParam.ambientStrength,
+                              lightParam.lightPos, 0.f});
             lightChanged = false;
         }
 
@@ -398,23 +602,26 @@ class WormRenderer {
         case RenderTarget::Worm:
             if (!wpd)
                 break;
+            if (inGridMode()) {
+                drawGrid(false);
+                break;
+            }
             glEnable(GL_DEPTH_TEST);
             glEnable(GL_CULL_FACE);
             glCullFace(GL_BACK);
 
-            bkgrndShader->use();
-            glBindTexture(GL_TEXTURE_2D, backgroundTex);
-            glBindVertexArray(backgroundVAO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            drawBackground();
 
             glCullFace(GL_FRONT);
 
-            wormShader->use();
-            wormShader->setVec3("color", WORM_BACK_COLOR);
-            wormShader->setBool("reverseNormal", true);
-            glBindVertexArray(wpd->GetVAO());
-            glDrawArrays(GL_LINE_STRIP, timeStep * wormVertCnt, wormVertCnt);
+            {
+                auto scope = profiler.Scope(BackFacePass);
+                wormShader->use();
+                wormShader->setVec3("color", WORM_BACK_COLOR);
+                wormShader->setBool("reverseNormal", true);
+                wormShader->setFloat("timeFrac", timeFrac);
+                wormMesh->Draw(timeStep, nextTimeStep);
+            }
 
             glCullFace(GL_BACK);
             if (frontFaceOpacity < 1.f) {
@@ -424,10 +631,12 @@ class WormRenderer {
                 glBlendColor(0, 0, 0, frontFaceOpacity);
             }
 
-            wormShader->setVec3("color", WORM_FRONT_COLOR);
-            wormShader->setBool("reverseNormal", false);
-            glBindVertexArray(wpd->GetVAO());
-            glDrawArrays(GL_LINE_STRIP, timeStep * wormVertCnt, wormVertCnt);
+            {
+                auto scope = profiler.Scope(FrontFacePass);
+                wormShader->setVec3("color", WORM_FRONT_COLOR);
+                wormShader->setBool("reverseNormal", false);
+                wormMesh->Draw(timeStep, nextTimeStep);
+            }
 
             glBindVertexArray(0);
             glDisable(GL_DEPTH_TEST);
@@ -443,39 +652,51 @@ class WormRenderer {
             glCullFace(GL_BACK);
 
             nuroShader->use();
-            nuroShader->setVec3("color", NURO_COLOR);
-            nuroShader->setFloat("halfWid", nuroHfWid);
-            glBindVertexArray(wnpd->GetVAO());
-            glDrawArrays(GL_POINTS, timeStep * nuroVertCnt, nuroVertCnt);
-
-            std::array<size_t, 3> inliersCnt{
-                wnpd->GetComponentInliersVertCnt(
-                    WormPositionData::Component::Head),
-                wnpd->GetComponentInliersVertCnt(
-                    WormPositionData::Component::VentralCord),
-                wnpd->GetComponentInliersVertCnt(
-                    WormPositionData::Component::Tail)};
-            size_t offset = 0;
-            nuroShader->setFloat("halfWid", nuroHfWid * 1.1f);
-            glBindVertexArray(wnpd->GetInliersVAO());
-            for (uint8_t cmpIdx = 0; cmpIdx < 3; ++cmpIdx) {
-                nuroShader->setVec3("color", CMP_COLORS[cmpIdx]);
-                glDrawElements(GL_POINTS, inliersCnt[cmpIdx], GL_UNSIGNED_INT,
-                               (const void *)(sizeof(GLuint) * offset));
-                offset += inliersCnt[cmpIdx];
+            {
+                auto scope = profiler.Scope(NeuronPass);
+                nuroShader->setVec3("color", NURO_COLOR);
+                nuroShader->setFloat("halfWid", nuroHfWid);
+                drawAllNeuronsAtTime(NURO_COLOR);
+            }
+
+            {
+                auto scope = profiler.Scope(InlierPass);
+                std::array<size_t, 3> inliersCnt{
+                    wnpd->GetComponentInliersVertCnt(
+                        WormPositionData::Component::Head),
+                    wnpd->GetComponentInliersVertCnt(
+                        WormPositionData::Component::VentralCord),
+                    wnpd->GetComponentInliersVertCnt(
+                        WormPositionData::Component::Tail)};
+                size_t offset = 0;
+                nuroShader->setFloat("halfWid", nuroHfWid * 1.1f);
+                for (uint8_t cmpIdx = 0; cmpIdx < 3; ++cmpIdx) {
+                    nuroShader->setVec3("color", CMP_COLORS[cmpIdx]);
+                    drawNeurons(wnpd->GetVBO(), 0, inliersCnt[cmpIdx],
+                                wnpd->GetInliersEBO(), offset);
+                    offset += inliersCnt[cmpIdx];
+                }
+
+                if (pickedNuroIdx != WormNeuronPositionData::NONE) {
+                    nuroShader->setVec3("color", SLCT_COLOR);
+                    nuroShader->setFloat("halfWid", nuroHfWid * 1.3f);
+                    drawNeuronsAtTime(pickedNuroIdx, 1);
+                }
             }
 
             glDisable(GL_DEPTH_TEST);
 
-            nuroShader->setVec3("color", SLCT_COLOR);
-            nuroShader->setFloat("halfWid", nuroHfWid * 1.2f);
-            glBindVertexArray(wnpd->GetCurveVAO());
-            glDrawArrays(GL_POINTS, 0, wnpd->GetCurveVertCnt());
+            {
+                auto scope = profiler.Scope(CurvePass);
+                nuroShader->setVec3("color", SLCT_COLOR);
+                nuroShader->setFloat("halfWid", nuroHfWid * 1.2f);
+                drawNeurons(wnpd->GetCurveVBO(), 0, wnpd->GetCurveVertCnt());
 
-            normalShader->use();
-            normalShader->setVec3("color", SLCT_COLOR);
-            glBindVertexArray(frameVAO);
-            glDrawElements(GL_LINE_STRIP, 5, GL_UNSIGNED_BYTE, 0);
+                normalShader->use();
+                normalShader->setVec3("color", SLCT_COLOR);
+                glBindVertexArray(frameVAO);
+                glDrawElements(GL_LINE_STRIP, 5, GL_UNSIGNED_BYTE, 0);
+            }
 
             glBindVertexArray(0);
             glDisable(GL_CULL_FACE);
@@ -488,26 +709,30 @@ class WormRenderer {
             glEnable(GL_CULL_FACE);
             glCullFace(GL_BACK);
 
-            bkgrndShader->use();
-            glBindTexture(GL_TEXTURE_2D, backgroundTex);
-            glBindVertexArray(backgroundVAO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            drawBackground();
 
             wormShader->use();
-            wormShader->setVec3("color", WORM_BACK_COLOR);
-            wormShader->setBool("reverseNormal", false);
-            glBindVertexArray(wpd->GetVAO());
-            glDrawArrays(GL_LINE_STRIP, timeStep * wormVertCnt, wormVertCnt);
+            {
+                auto scope = profiler.Scope(FrontFacePass);
+                wormShader->setVec3("color", WORM_BACK_COLOR);
+                wormShader->setBool("reverseNormal", false);
+                wormShader->setFloat("timeFrac", 0);
+                wormMesh->Draw(timeStep);
+            }
 
             glDisable(GL_DEPTH_TEST);
 
-            for (uint8_t cmpIdx = 0; cmpIdx < 3; ++cmpIdx) {
-                auto cmp = static_cast<WormPositionData::Component>(cmpIdx);
-                auto vertCnt = wpd->GetComponentVertCnt(cmp);
-                wormShader->setVec3("color", CMP_COLORS[cmpIdx]);
-                glBindVertexArray(wpd->GetComponentVAO(cmp));
-                glDrawElements(GL_LINE_STRIP, vertCnt, GL_UNSIGNED_INT, 0);
+            {
+                auto scope = profiler.Scope(ComponentPass);
+                for (uint8_t cmpIdx = 0; cmpIdx < 3; ++cmpIdx) {
+                    auto cmp =
+                        static_cast<WormPositionData::Component>(cmpIdx);
+                    auto [lft, rht] = wpd->GetComponentStartEnd(cmp);
+                    if (lft == rht)
+                        continue;
+                    wormShader->setVec3("color", CMP_COLORS[cmpIdx]);
+                    wormMesh->DrawRange(0, lft, rht);
+                }
             }
 
             glDisable(GL_CULL_FACE);
@@ -516,29 +741,40 @@ class WormRenderer {
         case RenderTarget::WormAndNeuron:
             if (!wpd || !wnpd)
                 break;
+            if (inGridMode()) {
+                drawGrid(true);
+                break;
+            }
             glEnable(GL_DEPTH_TEST);
             glEnable(GL_CULL_FACE);
             glCullFace(GL_BACK);
 
-            bkgrndShader->use();
-            glBindTexture(GL_TEXTURE_2D, backgroundTex);
-            glBindVertexArray(backgroundVAO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            drawBackground();
 
             nuroShader->use();
-            nuroShader->setVec3("color", NURO_COLOR);
-            nuroShader->setFloat("halfWid", nuroHfWid);
-            glBindVertexArray(wnpd->GetVAO());
-            glDrawArrays(GL_POINTS, timeStep * nuroVertCnt, nuroVertCnt);
+            {
+                auto scope = profiler.Scope(NeuronPass);
+                nuroShader->setVec3("color", NURO_COLOR);
+                nuroShader->setFloat("halfWid", nuroHfWid);
+                auto byActivity = bindActivities(nextTimeStep);
+                drawAllNeuronsAtTime(NURO_COLOR, byActivity);
+                if (byActivity)
+                    unbindActivities();
+            }
+
+            if (trailLen != 0)
+                drawTrails();
 
             glCullFace(GL_FRONT);
 
-            wormShader->use();
-            wormShader->setVec3("color", WORM_BACK_COLOR);
-            wormShader->setBool("reverseNormal", true);
-            glBindVertexArray(wpd->GetVAO());
-            glDrawArrays(GL_LINE_STRIP, timeStep * wormVertCnt, wormVertCnt);
+            {
+                auto scope = profiler.Scope(BackFacePass);
+                wormShader->use();
+                wormShader->setVec3("color", WORM_BACK_COLOR);
+                wormShader->setBool("reverseNormal", true);
+                wormShader->setFloat("timeFrac", timeFrac);
+                wormMesh->Draw(timeStep, nextTimeStep);
+            }
 
             glCullFace(GL_BACK);
             if (frontFaceOpacity < 1.f) {
@@ -548,10 +784,12 @@ class WormRenderer {
                 glBlendColor(0, 0, 0, frontFaceOpacity);
             }
 
-            wormShader->setVec3("color", WORM_FRONT_COLOR);
-            wormShader->setBool("reverseNormal", false);
-            glBindVertexArray(wpd->GetVAO());
-            glDrawArrays(GL_LINE_STRIP, timeStep * wormVertCnt, wormVertCnt);
+            {
+                auto scope = profiler.Scope(FrontFacePass);
+                wormShader->setVec3("color", WORM_FRONT_COLOR);
+                wormShader->setBool("reverseNormal", false);
+                wormMesh->Draw(timeStep, nextTimeStep);
+            }
 
             glBindVertexArray(0);
             glDisable(GL_DEPTH_TEST);
@@ -561,6 +799,8 @@ class WormRenderer {
         }
         if (drawWireFrame)
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        profiler.EndFrame();
     }
     void SetFrameVerts(const std::array<glm::vec2, 2> &pos2) {
         std::array<glm::vec3, 4> pos4;
@@ -572,7 +812,359 @@ class WormRenderer {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
     void SetNeuronHalfWidth(float hfWid) { nuroHfWid = hfWid; }
+    void SetPickedNeuron(size_t idx) { pickedNuroIdx = idx; }
     void SetFrontFaceOpacity(float opacity) { frontFaceOpacity = opacity; }
+
+  private:
+    inline void uploadModel(const glm::mat4 &M) {
+        model = M;
+        modelUBO->Upload({M});
+    }
+    inline bool inGridMode() const {
+        return !gridTimeSteps.empty() &&
+               (renderTarget == RenderTarget::Worm ||
+                renderTarget == RenderTarget::WormAndNeuron);
+    }
+    /// <summary>
+    /// Lay cells out row by row from the top left, in a grid centered on
+    /// the view, and rebuild the indirect commands of wormMesh
+    /// </summary>
+    void uploadGridCells() {
+        auto cellNum = gridTimeSteps.size();
+        auto colNum = static_cast<size_t>(
+            std::ceil(std::sqrt(static_cast<float>(cellNum))));
+        auto rowNum = (cellNum + colNum - 1) / colNum;
+        auto ndcScale = 1.f / std::max(colNum, rowNum);
+        auto timeCnt = wpd->GetVerts().size();
+
+        std::vector<GridCell> cells(cellNum);
+        for (size_t k = 0; k < cellNum; ++k) {
+            auto &cell = cells[k];
+            cell.timeStep = std::min(gridTimeSteps[k], timeCnt - 1);
+            auto [min, max] = wpd->GetPosRangeOf(cell.timeStep);
+            cell.posOffs = -.5f * (max + min);
+            auto col = k % colNum, row = k / colNum;
+            cell.ndcOffs = {(2.f * col + 1.f - colNum) * ndcScale,
+                            (rowNum - 2.f * row - 1.f) * ndcScale};
+            cell.ndcScale = ndcScale;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridCellSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GridCell) * cellNum,
+                     cells.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        wormMesh->SetInstancedTimeSteps(gridTimeSteps);
+    }
+    /// <summary>
+    /// The same passes as RenderTarget::Worm and RenderTarget::WormAndNeuron
+    /// without background, each drawing all cells at once
+    /// </summary>
+    void drawGrid(bool withNeurons) {
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        for (uint8_t i = 0; i < 4; ++i)
+            glEnable(GL_CLIP_DISTANCE0 + i);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_CELL_BINDING,
+                         gridCellSSBO);
+
+        if (withNeurons) {
+            auto scope = profiler.Scope(NeuronPass);
+            nuroShader->use();
+            nuroShader->setVec3("color", NURO_COLOR);
+            nuroShader->setFloat("halfWid", nuroHfWid);
+            nuroShader->setBool("grid", true);
+            nuroShader->setInt("gridNuroNum", nuroVertCnt);
+            drawNeurons(wnpd->GetVBO(), 0, nuroVertCnt * gridTimeSteps.size());
+            nuroShader->setBool("grid", false);
+        }
+
+        glCullFace(GL_FRONT);
+
+        wormShader->use();
+        wormShader->setBool("grid", true);
+        wormShader->setFloat("timeFrac", 0);
+        {
+            auto scope = profiler.Scope(BackFacePass);
+            wormShader->setVec3("color", WORM_BACK_COLOR);
+            wormShader->setBool("reverseNormal", true);
+            wormMesh->DrawInstancedTimeSteps();
+        }
+
+        glCullFace(GL_BACK);
+        if (frontFaceOpacity < 1.f) {
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+            glBlendColor(0, 0, 0, frontFaceOpacity);
+        }
+
+        {
+            auto scope = profiler.Scope(FrontFacePass);
+            wormShader->setVec3("color", WORM_FRONT_COLOR);
+            wormShader->setBool("reverseNormal", false);
+            wormMesh->DrawInstancedTimeSteps();
+        }
+        wormShader->setBool("grid", false);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_CELL_BINDING, 0);
+        for (uint8_t i = 0; i < 4; ++i)
+            glDisable(GL_CLIP_DISTANCE0 + i);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+    }
+    /// <summary>
+    /// Stream activities of timeStep and nextTimeStep, and bind them with
+    /// colormap to nuroShader in use. Return false if there is no usable
+    /// activity data.
+    /// </summary>
+    bool bindActivities(size_t nextTimeStep) {
+        if (!wnad || wnad->GetNeuronNum() != nuroVertCnt)
+            return false;
+        wnad->Upload(timeStep, nextTimeStep);
+        glActiveTexture(GL_TEXTURE0 + ACTIVITY_TEX_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, wnad->GetTex());
+        glActiveTexture(GL_TEXTURE0 + COLORMAP_TEX_UNIT);
+        glBindTexture(GL_TEXTURE_1D, colormapTex);
+        glActiveTexture(GL_TEXTURE0);
+        setActivityUniforms(*nuroShader, true);
+        return true;
+    }
+    void unbindActivities() {
+        setActivityUniforms(*nuroShader, false);
+        glActiveTexture(GL_TEXTURE0 + ACTIVITY_TEX_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0 + COLORMAP_TEX_UNIT);
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    /// <summary>
+    /// Set uniforms of activity coloring to shader in use
+    /// </summary>
+    void setActivityUniforms(Shader &shader, bool enabled) {
+        shader.setBool("colorByActivity", enabled);
+        if (!enabled)
+            return;
+        auto [min, max] = wnad->GetRange();
+        shader.setInt("actNuroNum", nuroVertCnt);
+        shader.setVec2("activityRange", min, max);
+    }
+    /// <summary>
+    /// Collect neurons which may be inside the view frustum between
+    /// timeStep and the next one into nuroVisIdxs. Spheres are swollen by
+    /// their radius, thus those partially inside are kept.
+    /// All are kept until the trajectory index is built in background.
+    /// </summary>
+    void cullNeurons(size_t nextTimeStep) {
+        KOUEK_TRACE_SCOPE("render", "CullNeurons");
+        auto trajIdx = wnpd->PinTrajectoryIndex();
+        if (!nuroCulling || !trajIdx) {
+            nuroVisIdxs.resize(nuroVertCnt);
+            for (uint32_t nuroIdx = 0; nuroIdx < nuroVertCnt; ++nuroIdx)
+                nuroVisIdxs[nuroIdx] = nuroIdx;
+            return;
+        }
+        // in the space of wnpd, where spheres have radius nuroHfWid
+        Frustum frustum(proj * view * model);
+        trajIdx->Query(frustum, timeStep, nextTimeStep, glm::vec3{nuroHfWid},
+                       nuroVisIdxs);
+    }
+    /// <summary>
+    /// Bucket visible neurons at timeStep into LODs by their projected
+    /// radii, then upload nuroLODIdxs packed by LOD and their indirect
+    /// commands. A neuron of radius r at view depth d covers
+    /// r * pxPerUnit / d pixels, thus each LOD is a range of depth, and one
+    /// pass of a dot product per neuron selects them all. Neurons behind
+    /// the camera are dropped. If LOD is disabled, all go to full LOD.
+    /// </summary>
+    void selectNeuronLODs(GLfloat pxPerUnit) {
+        KOUEK_TRACE_SCOPE("render", "SelectNeuronLODs");
+        auto VM = view * model;
+        auto radius = nuroHfWid * glm::length(glm::vec3(model[0]));
+        auto fullMaxDep = radius * pxPerUnit / nuroLODFullMinPx;
+        auto coarseMaxDep = radius * pxPerUnit / nuroLODCoarseMinPx;
+        const auto &verts =
+            wnpd->GetVerts()[std::min(timeStep, wnpd->GetVerts().size() - 1)];
+
+        constexpr uint8_t DROPPED = 3;
+        nuroLODs.resize(nuroVisIdxs.size());
+        nuroLODCnts.fill(0);
+        for (size_t visIdx = 0; visIdx < nuroVisIdxs.size(); ++visIdx) {
+            const auto &pos = verts[nuroVisIdxs[visIdx]];
+            auto dep = -(VM[0][2] * pos.x + VM[1][2] * pos.y +
+                         VM[2][2] * pos.z + VM[3][2]);
+            uint8_t lod = DROPPED;
+            if (dep > 0)
+                lod = !nuroLOD || dep <= fullMaxDep ? 0
+                      : dep <= coarseMaxDep         ? 1
+                                                    : 2;
+            nuroLODs[visIdx] = lod;
+            if (lod != DROPPED)
+                ++nuroLODCnts[lod];
+        }
+        std::array<GLsizei, 3> offs{0, nuroLODCnts[0],
+                                    nuroLODCnts[0] + nuroLODCnts[1]};
+        auto visNum = offs[2] + nuroLODCnts[2];
+        nuroLODIdxs.resize(visNum);
+        for (size_t visIdx = 0; visIdx < nuroVisIdxs.size(); ++visIdx)
+            if (auto lod = nuroLODs[visIdx]; lod != DROPPED)
+                nuroLODIdxs[offs[lod]++] = nuroVisIdxs[visIdx];
+
+        NeuronDrawCommands cmds;
+        cmds.full = {static_cast<GLuint>(nuroMesh->GetIndexCnt()),
+                     static_cast<GLuint>(nuroLODCnts[0]), 0, 0, 0};
+        cmds.coarse = {static_cast<GLuint>(coarseNuroMesh->GetIndexCnt()),
+                       static_cast<GLuint>(nuroLODCnts[1]), 0, 0, 0};
+        cmds.impostor = {static_cast<GLuint>(nuroLODCnts[2]), 1, 0, 0};
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, nuroLODCmdBuf);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(cmds), &cmds,
+                     GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, nuroLODIdxBuf);
+        // keep the buffer non-empty, since binding an empty one is invalid
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     sizeof(GLuint) * std::max<size_t>(visNum, 1),
+                     nuroLODIdxs.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    /// <summary>
+    /// Draw neurons of wnpd passing culling at the fractional time with
+    /// nuroShader in use, through LODs if enabled. Impostors take color,
+    /// and activities if byActivity, see bindActivities().
+    /// </summary>
+    void drawAllNeuronsAtTime(const glm::vec3 &color, bool byActivity = false) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        auto pxPerUnit = proj[1][1] * .5f * viewport[3];
+        auto nextTimeStep =
+            std::min(timeStep + 1, wnpd->GetVerts().size() - 1);
+        cullNeurons(nextTimeStep);
+        selectNeuronLODs(pxPerUnit);
+
+        auto nuroOffs = timeStep * nuroVertCnt;
+        auto nextNuroOffs = nextTimeStep * nuroVertCnt;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, nuroLODCmdBuf);
+        drawNeurons(wnpd->GetVBO(), nuroOffs, nuroLODCnts[0], nuroLODIdxBuf, 0,
+                    nextNuroOffs, timeFrac, nuroMesh.get(),
+                    offsetof(NeuronDrawCommands, full));
+        drawNeurons(wnpd->GetVBO(), nuroOffs, nuroLODCnts[1], nuroLODIdxBuf,
+                    nuroLODCnts[0], nextNuroOffs, timeFrac,
+                    coarseNuroMesh.get(), offsetof(NeuronDrawCommands, coarse));
+        if (nuroLODCnts[2] != 0) {
+            impostorShader->use();
+            impostorShader->setVec3("color", color);
+            impostorShader->setFloat("halfWid", nuroHfWid);
+            impostorShader->setInt("nuroOffs", nuroOffs);
+            impostorShader->setInt("nextNuroOffs", nextNuroOffs);
+            impostorShader->setFloat("timeFrac", timeFrac);
+            impostorShader->setInt("idxOffs",
+                                   nuroLODCnts[0] + nuroLODCnts[1]);
+            impostorShader->setFloat("pxPerUnit", pxPerUnit);
+            impostorShader->setMat3("viewRotInv",
+                                    glm::transpose(glm::mat3(view)));
+            setActivityUniforms(*impostorShader, byActivity);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, wnpd->GetVBO());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, nuroLODIdxBuf);
+            glEnable(GL_PROGRAM_POINT_SIZE);
+            glBindVertexArray(emptyVAO);
+            glDrawArraysIndirect(
+                GL_POINTS,
+                reinterpret_cast<const void *>(
+                    offsetof(NeuronDrawCommands, impostor)));
+            glBindVertexArray(0);
+            glDisable(GL_PROGRAM_POINT_SIZE);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+            nuroShader->use();
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    /// <summary>
+    /// All trails in a single instanced draw, one line strip per neuron,
+    /// whose vertices index wnpd's time-major positions by time step
+    /// </summary>
+    void drawTrails() {
+        auto scope = profiler.Scope(TrailPass);
+        auto firstTimeStep = timeStep < trailLen ? 0 : timeStep - trailLen;
+        auto nextTimeStep =
+            std::min(timeStep + 1, wnpd->GetVerts().size() - 1);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        trailShader->use();
+        trailShader->setVec3("color", TRAIL_COLOR);
+        trailShader->setInt("nuroNum", nuroVertCnt);
+        trailShader->setInt("firstTimeStep", firstTimeStep);
+        trailShader->setInt("currTimeStep", timeStep);
+        trailShader->setInt("nextTimeStep", nextTimeStep);
+        trailShader->setFloat("timeFrac", timeFrac);
+        trailShader->setFloat("trailLen", trailLen);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, wnpd->GetVBO());
+        glBindVertexArray(emptyVAO);
+        // time steps in [first, curr], plus the interpolated head
+        glDrawArraysInstanced(GL_LINE_STRIP, 0, timeStep - firstTimeStep + 2,
+                              nuroVertCnt);
+        glBindVertexArray(0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
+    void drawBackground() {
+        auto scope = profiler.Scope(BackgroundPass);
+        bkgrndShader->use();
+        glBindTexture(GL_TEXTURE_2D, backgroundTex);
+        glBindVertexArray(backgroundVAO);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    /// <summary>
+    /// Draw nuroNum neuron spheres with nuroShader in use, whose positions
+    /// are packed vec3 in posBuf starting from neuron nuroOffs.
+    /// If idxBuf is not 0, instances are picked by GLuint indices in idxBuf
+    /// starting from idxOffs.
+    /// Positions move by timeFrac towards those starting from nextNuroOffs.
+    /// Spheres are nuroMesh unless mesh is given.
+    /// If cmdOffs is not NO_CMD, the instance count is read from the
+    /// command at cmdOffs of the bound GL_DRAW_INDIRECT_BUFFER instead,
+    /// while nuroNum only skips empty draws.
+    /// </summary>
+    void drawNeurons(GLuint posBuf, size_t nuroOffs, size_t nuroNum,
+                     GLuint idxBuf = 0, size_t idxOffs = 0,
+                     size_t nextNuroOffs = 0, GLfloat timeFrac = 0,
+                     const SphereMesh *mesh = nullptr,
+                     size_t cmdOffs = NO_CMD) {
+        if (nuroNum == 0)
+            return;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, posBuf);
+        if (idxBuf != 0)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, idxBuf);
+        nuroShader->setInt("nuroOffs", nuroOffs);
+        nuroShader->setInt("nextNuroOffs", nextNuroOffs);
+        nuroShader->setFloat("timeFrac", timeFrac);
+        nuroShader->setInt("idxOffs", idxOffs);
+        nuroShader->setBool("indexed", idxBuf != 0);
+        if (!mesh)
+            mesh = nuroMesh.get();
+        if (cmdOffs == NO_CMD)
+            mesh->DrawInstanced(nuroNum);
+        else
+            mesh->DrawIndirect(cmdOffs);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    }
+    /// <summary>
+    /// Draw neurons [nuroIdx, nuroIdx + nuroNum) of wnpd at the fractional
+    /// time
+    /// </summary>
+    void drawNeuronsAtTime(size_t nuroIdx, size_t nuroNum) {
+        auto nextTimeStep =
+            std::min(timeStep + 1, wnpd->GetVerts().size() - 1);
+        drawNeurons(wnpd->GetVBO(), timeStep * nuroVertCnt + nuroIdx, nuroNum,
+                    0, 0, nextTimeStep * nuroVertCnt + nuroIdx, timeFrac);
+    }
 };
 
 } // namespace kouek
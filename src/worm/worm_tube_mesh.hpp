@@ -0,0 +1,297 @@
+#ifndef KOUEK_WORM_TUBE_MESH_H
+#define KOUEK_WORM_TUBE_MESH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <util/trace.hpp>
+
+#include "worm_data.hpp"
+
+namespace kouek {
+/// <summary>
+/// Tube mesh of worm through all time steps, generated once on CPU.
+/// Each center vertex of the worm is swept into a ring of divNum vertices,
+/// neighboring rings are connected by triangles, and head and tail are
+/// closed by cones. All time steps share the same topology, thus one index
+/// buffer is drawn with vertex buffer bindings offset to the time step.
+/// Attributes 0 and 1 (position and normal) come from binding 0, and
+/// attributes 2 and 3 from binding 1, which holds the next time step so
+/// that shaders can interpolate between them.
+/// Attribute 4 (uint) comes from binding 2 per instance, and is only
+/// enabled by DrawInstancedTimeSteps().
+/// </summary>
+class WormTubeMesh {
+  public:
+    static constexpr float HEAD_K = .2f;
+    static constexpr float TAIL_K = 3.f;
+
+  private:
+    struct Vertex {
+        glm::vec3 pos;
+        glm::vec3 normal;
+    };
+
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    uint8_t divNum;
+    size_t cntrVertCnt, timeCnt;
+    GLsizei meshVertCnt, idxCnt, cmdCnt = 0;
+    GLuint VAO, VBO, EBO, cmdBuf = 0, instBuf = 0;
+
+  public:
+    /// <summary>
+    /// threadNum == 0 uses all hardware threads
+    /// </summary>
+    WormTubeMesh(const WormPositionData &wpd, uint8_t divNum,
+                 uint32_t threadNum = 0)
+        : divNum(std::max(divNum, (uint8_t)3)) {
+        KOUEK_TRACE_SCOPE("mesh", "BuildWormTubeMesh");
+        auto &verts = wpd.GetVerts();
+        timeCnt = verts.size();
+        cntrVertCnt = verts.front().size();
+        // rings, then head cone tips, then tail cone tips
+        meshVertCnt = (cntrVertCnt + 2) * this->divNum;
+
+        std::vector<Vertex> meshVerts;
+        std::vector<GLuint> indices;
+        if (cntrVertCnt >= 2) {
+            meshVerts.resize(meshVertCnt * timeCnt);
+            indices = triangulate();
+        }
+        if (threadNum == 0)
+            threadNum = std::max(std::thread::hardware_concurrency(), 1u);
+        threadNum = std::min(threadNum, static_cast<uint32_t>(timeCnt));
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(threadNum);
+            auto chunk = (timeCnt + threadNum - 1) / threadNum;
+            for (size_t beg = 0; beg < timeCnt && !meshVerts.empty();
+                 beg += chunk)
+                threads.emplace_back([&, beg]() {
+                    KOUEK_TRACE_SCOPE("mesh", "SweepWormTubeRings");
+                    auto end = std::min(beg + chunk, timeCnt);
+                    for (auto t = beg; t < end; ++t)
+                        sweep(verts[t], &meshVerts[meshVertCnt * t]);
+                });
+            for (auto &thread : threads)
+                thread.join();
+        }
+        idxCnt = indices.size();
+
+        KOUEK_TRACE_SCOPE("upload", "UploadWormTubeMesh");
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        for (GLuint slice = 0; slice < 2; ++slice) {
+            glEnableVertexAttribArray(2 * slice);
+            glVertexAttribFormat(2 * slice, 3, GL_FLOAT, GL_FALSE,
+                                 offsetof(Vertex, pos));
+            glVertexAttribBinding(2 * slice, slice);
+            glEnableVertexAttribArray(2 * slice + 1);
+            glVertexAttribFormat(2 * slice + 1, 3, GL_FLOAT, GL_FALSE,
+                                 offsetof(Vertex, normal));
+            glVertexAttribBinding(2 * slice + 1, slice);
+        }
+        glVertexAttribIFormat(4, 1, GL_UNSIGNED_INT, 0);
+        glVertexAttribBinding(4, 2);
+        glVertexBindingDivisor(2, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshVerts.size(),
+                     meshVerts.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * idxCnt,
+                     indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    ~WormTubeMesh() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        if (cmdBuf != 0) {
+            glDeleteBuffers(1, &cmdBuf);
+            glDeleteBuffers(1, &instBuf);
+        }
+    }
+    WormTubeMesh(const WormTubeMesh &) = delete;
+    WormTubeMesh &operator=(const WormTubeMesh &) = delete;
+    inline auto GetDivisionNum() const { return divNum; }
+    inline void Draw(size_t timeStep) const {
+        DrawRange(timeStep, timeStep, 0, cntrVertCnt);
+    }
+    inline void Draw(size_t timeStep, size_t nextTimeStep) const {
+        DrawRange(timeStep, nextTimeStep, 0, cntrVertCnt);
+    }
+    inline void DrawRange(size_t timeStep, size_t lft, size_t rht) const {
+        DrawRange(timeStep, timeStep, lft, rht);
+    }
+    /// <summary>
+    /// Draw the part of tube swept by center vertices in [lft, rht).
+    /// Cones are drawn only if the part contains head or tail.
+    /// Bindings 0 and 1 are set to timeStep and nextTimeStep.
+    /// </summary>
+    void DrawRange(size_t timeStep, size_t nextTimeStep, size_t lft,
+                   size_t rht) const {
+        rht = std::min(rht, cntrVertCnt);
+        if (lft + 1 >= rht)
+            return;
+        auto first = lft == 0 ? 0 : 3 * divNum + 6 * divNum * lft;
+        auto last =
+            rht == cntrVertCnt ? idxCnt : 3 * divNum + 6 * divNum * (rht - 1);
+        glBindVertexArray(VAO);
+        glBindVertexBuffer(0, VBO, sizeof(Vertex) * meshVertCnt * timeStep,
+                           sizeof(Vertex));
+        glBindVertexBuffer(1, VBO, sizeof(Vertex) * meshVertCnt * nextTimeStep,
+                           sizeof(Vertex));
+        glDrawElements(GL_TRIANGLES, last - first, GL_UNSIGNED_INT,
+                       (const void *)(sizeof(GLuint) * first));
+        glBindVertexArray(0);
+    }
+    /// <summary>
+    /// Build the indirect commands of DrawInstancedTimeSteps(), one per
+    /// time step in timeSteps. Command k draws the whole tube at
+    /// timeSteps[k] by base vertex, as instance k whose attribute 4 is k.
+    /// </summary>
+    void SetInstancedTimeSteps(const std::vector<size_t> &timeSteps) {
+        std::vector<DrawCommand> cmds;
+        std::vector<GLuint> instIdxs;
+        cmds.reserve(timeSteps.size());
+        instIdxs.reserve(timeSteps.size());
+        for (GLuint k = 0; k < timeSteps.size(); ++k) {
+            auto t = std::min(timeSteps[k], timeCnt - 1);
+            cmds.push_back({static_cast<GLuint>(idxCnt), 1, 0,
+                            static_cast<GLint>(meshVertCnt * t), k});
+            instIdxs.push_back(k);
+        }
+        cmdCnt = cmds.size();
+
+        if (cmdBuf == 0) {
+            glGenBuffers(1, &cmdBuf);
+            glGenBuffers(1, &instBuf);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmdBuf);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * cmdCnt,
+                     cmds.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, instBuf);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * cmdCnt, instIdxs.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    /// <summary>
+    /// Draw time steps set by SetInstancedTimeSteps() in a single
+    /// glMultiDrawElementsIndirect. Bindings 0 and 1 both start from time
+    /// step 0, thus shaders should not interpolate.
+    /// </summary>
+    void DrawInstancedTimeSteps() const {
+        if (cmdCnt == 0)
+            return;
+        glBindVertexArray(VAO);
+        glBindVertexBuffer(0, VBO, 0, sizeof(Vertex));
+        glBindVertexBuffer(1, VBO, 0, sizeof(Vertex));
+        glBindVertexBuffer(2, instBuf, 0, sizeof(GLuint));
+        glEnableVertexAttribArray(4);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmdBuf);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                    cmdCnt, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glDisableVertexAttribArray(4);
+        glBindVertexArray(0);
+    }
+
+  private:
+    /// <summary>
+    /// Ring k of a center vertex is its delta rotated by -2*pi*k/divNum
+    /// around the axis perpendicular to both delta and -Z.
+    /// Each cone tip is duplicated per ring edge, taking the averaged
+    /// normal of the edge.
+    /// </summary>
+    template <typename VertsTy>
+    void sweep(const VertsTy &vertsT, Vertex *meshVertsT) const {
+        for (size_t vIdx = 0; vIdx < cntrVertCnt; ++vIdx) {
+            glm::vec3 cntrPos{glm::vec2(vertsT[vIdx].cntrPos), 0};
+            auto &delta = vertsT[vIdx].delta;
+            auto axis =
+                glm::normalize(glm::cross(delta, glm::vec3{0, 0, -1.f}));
+            for (uint8_t k = 0; k < divNum; ++k) {
+                auto theta = glm::pi<float>() * 2.f * k / divNum;
+                auto c = cosf(theta), s = sinf(theta), oc = 1.f - c;
+                glm::mat3 rot{oc * axis.x * axis.x + c,
+                              oc * axis.x * axis.y - axis.z * s,
+                              oc * axis.z * axis.x + axis.y * s,
+                              oc * axis.x * axis.y + axis.z * s,
+                              oc * axis.y * axis.y + c,
+                              oc * axis.y * axis.z - axis.x * s,
+                              oc * axis.z * axis.x - axis.y * s,
+                              oc * axis.y * axis.z + axis.x * s,
+                              oc * axis.z * axis.z + c};
+                auto &vert = meshVertsT[vIdx * divNum + k];
+                vert.normal = rot * delta;
+                vert.pos = cntrPos + vert.normal;
+            }
+        }
+
+        auto cone = [&](size_t ringVIdx, size_t nextVIdx, float K,
+                        Vertex *tips) {
+            glm::vec2 tip = (1.f + K) * glm::vec2(vertsT[ringVIdx].cntrPos) -
+                            K * glm::vec2(vertsT[nextVIdx].cntrPos);
+            auto ring = &meshVertsT[ringVIdx * divNum];
+            for (uint8_t k = 0; k < divNum; ++k) {
+                tips[k].pos = glm::vec3{tip, 0};
+                tips[k].normal =
+                    .5f * (ring[k].normal + ring[(k + 1) % divNum].normal);
+            }
+        };
+        cone(0, 1, HEAD_K, &meshVertsT[cntrVertCnt * divNum]);
+        cone(cntrVertCnt - 1, cntrVertCnt - 2, TAIL_K,
+             &meshVertsT[(cntrVertCnt + 1) * divNum]);
+    }
+    /// <summary>
+    /// Indices are ordered as head cone, segments from head to tail, then
+    /// tail cone, so that any range of segments is contiguous.
+    /// Triangles are counter-clockwise seen from outside.
+    /// </summary>
+    std::vector<GLuint> triangulate() const {
+        auto ringVert = [&](size_t vIdx, uint8_t k) -> GLuint {
+            return vIdx * divNum + k % divNum;
+        };
+        GLuint headTip = cntrVertCnt * divNum;
+        GLuint tailTip = (cntrVertCnt + 1) * divNum;
+
+        std::vector<GLuint> indices;
+        indices.reserve(6 * divNum * cntrVertCnt);
+        for (uint8_t k = 0; k < divNum; ++k)
+            indices.insert(indices.end(),
+                           {ringVert(0, k), headTip + k, ringVert(0, k + 1)});
+        for (size_t vIdx = 0; vIdx + 1 < cntrVertCnt; ++vIdx)
+            for (uint8_t k = 0; k < divNum; ++k)
+                indices.insert(indices.end(),
+                               {ringVert(vIdx, k), ringVert(vIdx, k + 1),
+                                ringVert(vIdx + 1, k), ringVert(vIdx + 1, k),
+                                ringVert(vIdx, k + 1),
+                                ringVert(vIdx + 1, k + 1)});
+        for (uint8_t k = 0; k < divNum; ++k)
+            indices.insert(indices.end(),
+                           {ringVert(cntrVertCnt - 1, k),
+                            ringVert(cntrVertCnt - 1, k + 1), tailTip + k});
+        return indices;
+    }
+};
+} // namespace kouek
+
+#endif // !KOUEK_WORM_TUBE_MESH_H
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <util/hash_grid.hpp>
+#include <util/point_octree.hpp>
+
+using namespace kouek;
+
+int main() {
+    auto [min, max] = std::pair{glm::vec3{-1.f}, glm::vec3{1.f}};
+    constexpr uint32_t POINT_NUM = 20000;
+    constexpr uint32_t QUERY_NUM = 200;
+
+    // half uniform, half in a small cluster to stress bucket collisions
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::normal_distribution<float> normal(0, .02f);
+    std::vector<std::pair<glm::vec3, uint32_t>> dat;
+    for (uint32_t id = 0; id < POINT_NUM; ++id)
+        if (id % 2 == 0)
+            dat.emplace_back(
+                glm::vec3{uniform(random), uniform(random), uniform(random)},
+                id);
+        else
+            dat.emplace_back(
+                glm::clamp(glm::vec3{.5f + normal(random), normal(random),
+                                     normal(random)},
+                           min, max),
+                id);
+    dat.emplace_back(max + 1.f, POINT_NUM); // out of bound
+
+    for (uint32_t threadNum : {1u, 4u}) {
+        HashGrid<uint32_t> grid(min, max, dat, 0, threadNum);
+        assert(grid.GetDatNum() == POINT_NUM);
+        std::cout << "HashGrid dim " << grid.GetDim().x << 'x'
+                  << grid.GetDim().y << 'x' << grid.GetDim().z
+                  << " cell size " << grid.GetCellSize() << std::endl;
+
+        // Query test
+        for (uint32_t id = 0; id < POINT_NUM; ++id) {
+            [[maybe_unused]] auto found = grid.Query(dat[id].first, 0);
+            assert(found && found->first == dat[id].first);
+        }
+        assert(!grid.Query(max + 1.f));
+
+        // Radius query test
+        for (uint32_t qIdx = 0; qIdx < QUERY_NUM; ++qIdx) {
+            glm::vec3 cntr{uniform(random), uniform(random), uniform(random)};
+            if (qIdx % 2 == 1)
+                cntr = dat[qIdx].first;
+            auto radius = (uniform(random) + 1.f) * .1f;
+            std::vector<uint32_t> bruteForce;
+            for (uint32_t id = 0; id < POINT_NUM; ++id) {
+                auto dlt = dat[id].first - cntr;
+                if (glm::dot(dlt, dlt) <= radius * radius)
+                    bruteForce.emplace_back(id);
+            }
+            auto selected = grid.QueryDat(cntr, radius);
+            std::sort(selected.begin(), selected.end());
+            assert(selected == bruteForce);
+        }
+
+        // Frustum query test
+        for (auto halfWid : {.05f, .3f, 2.f}) {
+            glm::vec3 pos{.2f, -.1f, 1.5f};
+            auto drc = [&](float x, float y) {
+                return glm::vec3(glm::lookAt(pos, glm::vec3{x, y, 0},
+                                             glm::vec3{0, 1.f, 0}) *
+                                 glm::vec4{0, 0, -1.f, 0});
+            };
+            Frustum frustum(pos, glm::vec3{0, 0, -1.f}, .01f, 10.f,
+                            drc(-halfWid, -halfWid), drc(-halfWid, +halfWid),
+                            drc(+halfWid, -halfWid), drc(+halfWid, +halfWid));
+            std::vector<uint32_t> bruteForce;
+            for (uint32_t id = 0; id < POINT_NUM; ++id)
+                if (frustum.IsIntersetcedWith(dat[id].first))
+                    bruteForce.emplace_back(id);
+            auto selected = grid.QueryDat(frustum);
+            std::sort(selected.begin(), selected.end());
+            assert(selected == bruteForce);
+        }
+    }
+
+    // Radius query of PointOctree shares the semantics
+    PointOctree<uint32_t> poctr(min, max, dat, 0);
+    HashGrid<uint32_t> grid(min, max, dat);
+    for (uint32_t qIdx = 0; qIdx < QUERY_NUM; ++qIdx) {
+        glm::vec3 cntr{uniform(random), uniform(random), uniform(random)};
+        auto radius = (uniform(random) + 1.f) * .2f;
+        auto octreeSelected = poctr.QueryDat(cntr, radius);
+        auto gridSelected = grid.QueryDat(cntr, radius);
+        std::sort(octreeSelected.begin(), octreeSelected.end());
+        std::sort(gridSelected.begin(), gridSelected.end());
+        assert(octreeSelected == gridSelected);
+    }
+
+    // Points clustered in a tiny part of wide bounds make a grid of far
+    // more cells than points, which queries should not walk one by one
+    {
+        auto [sparseMin, sparseMax] =
+            std::pair{glm::vec3{-1000.f}, glm::vec3{1000.f}};
+        std::vector<std::pair<glm::vec3, uint32_t>> clustered;
+        for (uint32_t id = 0; id < POINT_NUM; ++id)
+            clustered.emplace_back(
+                glm::vec3{normal(random), normal(random), normal(random)},
+                id);
+        HashGrid<uint32_t> sparse(sparseMin, sparseMax, clustered);
+        [[maybe_unused]] auto dim = sparse.GetDim();
+        assert(static_cast<double>(dim.x) * dim.y * dim.z > 1e12);
+
+        glm::vec3 pos{0, 0, 2000.f};
+        auto drc = [&](float x, float y) {
+            return glm::normalize(glm::vec3{x, y, -1.f});
+        };
+        Frustum frustum(pos, glm::vec3{0, 0, -1.f}, .01f, 5000.f,
+                        drc(-1.f, -1.f), drc(-1.f, +1.f), drc(+1.f, -1.f),
+                        drc(+1.f, +1.f));
+        [[maybe_unused]] auto selected = sparse.QueryDat(frustum);
+        assert(selected.size() == POINT_NUM);
+        selected = sparse.QueryDat(glm::vec3{0}, 1500.f);
+        assert(selected.size() == POINT_NUM);
+    }
+
+    return 0;
+}
@@ -1,8 +1,12 @@
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
 #include <iostream>
 #include <vector>
 #include <random>
 
 #include <util/point_octree.hpp>
+#include <util/point_octree_snapshot.hpp>
 
 using namespace kouek;
 
@@ -37,7 +41,7 @@ int main() {
     //}
 
     // Query test 2
-    PointOctree<uint32_t> poctr2(min, max, 2);
+    PointOctree<uint32_t, 2> poctr2(min, max);
     constexpr uint32_t X_DIM = 10;
     constexpr uint32_t Y_DIM = 10;
     constexpr float SPACE = .1f;
@@ -66,5 +70,176 @@ int main() {
                     drcs[1], drcs[3]);
     auto selected = poctr2.Query(frustum);
 
+    // Remove and Update test
+    PointOctree<uint32_t, 4> poctr3(min, max);
+    constexpr uint32_t DYN_POINT_NUM = 1000;
+    constexpr float MAX_STEP = .05f;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::uniform_real_distribution<float> step(-MAX_STEP, MAX_STEP);
+    points.clear();
+    for (uint32_t id = 0; id < DYN_POINT_NUM; ++id) {
+        points.emplace_back(uniform(random), uniform(random), uniform(random));
+        poctr3.Insert(points.back(), id);
+    }
+    for (uint32_t id = 0; id < DYN_POINT_NUM; id += 2) {
+        [[maybe_unused]] bool removed = poctr3.Remove(points[id]);
+        assert(removed);
+        assert(!poctr3.Query(points[id]).first);
+    }
+    for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2) {
+        pos = glm::clamp(points[id] + glm::vec3{step(random), step(random),
+                                                step(random)},
+                         min, max);
+        [[maybe_unused]] bool updated = poctr3.Update(points[id], pos);
+        assert(updated);
+        points[id] = pos;
+    }
+    for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2) {
+        [[maybe_unused]] auto [node, datIdx] = poctr3.Query(points[id]);
+        assert(node && node->dat[datIdx].second == id);
+    }
+
+    // Coincident Update test, points moved onto an occupied position are
+    // dropped as duplicates instead of splitting leaves endlessly
+    {
+        PointOctree<uint32_t, 4> poctr(min, max);
+        glm::vec3 target{.5f, .5f, .5f};
+        std::vector<glm::vec3> srcs;
+        for (uint32_t id = 0; id <= poctr.LEAF_CAP; ++id) {
+            srcs.emplace_back(-.5f + .1f * id, -.5f, -.5f);
+            poctr.Insert(srcs.back(), id);
+        }
+        for (uint32_t id = 0; id <= poctr.LEAF_CAP; ++id) {
+            [[maybe_unused]] bool updated = poctr.Update(srcs[id], target);
+            assert(updated == (id == 0));
+        }
+        [[maybe_unused]] auto [node, datIdx] = poctr.Query(target);
+        assert(node && node->dat[datIdx].second == 0);
+        assert(poctr.GetStats().datNum == 1);
+    }
+
+    // Stats test
+    {
+        auto stats = poctr3.GetStats();
+        std::cout << stats << std::endl;
+        assert(stats.datNum == DYN_POINT_NUM / 2);
+        size_t leafNum = 0, fillSum = 0;
+        for (size_t num = 0; num <= poctr3.LEAF_CAP; ++num) {
+            leafNum += stats.leafFillHist[num];
+            fillSum += num * stats.leafFillHist[num];
+        }
+        assert(leafNum == stats.leafNum && fillSum == stats.datNum);
+        size_t nodeNum = 0;
+        for (auto num : stats.nodeDepthHist)
+            nodeNum += num;
+        assert(nodeNum == stats.nodeNum);
+        assert(stats.childSlotNum == 8 * (stats.nodeNum - stats.leafNum));
+        assert(stats.nodeNum == 1 + stats.childSlotNum - stats.emptyChildNum);
+    }
+
+    // Bulk build test
+    {
+        std::vector<std::pair<glm::vec3, uint32_t>> dat;
+        for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2)
+            dat.emplace_back(points[id], id);
+        dat.emplace_back(points[1], 1); // duplicate
+        dat.emplace_back(max + 1.f, 0); // out of bound
+        PointOctree<uint32_t, 4> poctr4(min, max, dat);
+        assert(poctr4.GetStats().datNum == DYN_POINT_NUM / 2);
+        for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2) {
+            [[maybe_unused]] auto [node, datIdx] = poctr4.Query(points[id]);
+            assert(node && node->dat[datIdx].second == id);
+        }
+    }
+
+    // Query point data in frustum test
+    std::vector<uint32_t> inFrustum;
+    for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2)
+        if (frustum.IsIntersetcedWith(points[id]))
+            inFrustum.emplace_back(id);
+    auto selectedDat = poctr3.QueryDat(frustum);
+    std::sort(selectedDat.begin(), selectedDat.end());
+    assert(selectedDat == inFrustum);
+
+    // Batch frustum test, over lengths covering SIMD and scalar tails
+    for (size_t num : {size_t(0), size_t(3), size_t(64), size_t(77),
+                       static_cast<size_t>(DYN_POINT_NUM)}) {
+        std::vector<float> xs(num), ys(num), zs(num);
+        for (size_t id = 0; id < num; ++id) {
+            xs[id] = points[id].x;
+            ys[id] = points[id].y;
+            zs[id] = points[id].z;
+        }
+        std::vector<uint64_t> aosMask(Frustum::GetMaskWordNum(num));
+        std::vector<uint64_t> soaMask(aosMask.size());
+        frustum.IsIntersetcedWith(points.data(), num, aosMask.data());
+        frustum.IsIntersetcedWith(xs.data(), ys.data(), zs.data(), num,
+                                  soaMask.data());
+        assert(aosMask == soaMask);
+        for (size_t id = 0; id < num; ++id)
+            assert(((aosMask[id / Frustum::MASK_BIT_NUM] >>
+                     (id % Frustum::MASK_BIT_NUM)) &
+                    0x1) == frustum.IsIntersetcedWith(points[id]));
+    }
+
+    // Ray query test
+    constexpr uint32_t RAY_NUM = 200;
+    constexpr float RADIUS = .05f;
+    for (uint32_t rayIdx = 0; rayIdx < RAY_NUM; ++rayIdx) {
+        glm::vec3 org{uniform(random), uniform(random), 2.f};
+        auto drc = glm::normalize(
+            glm::vec3{uniform(random), uniform(random), uniform(random) - 2.f});
+        float minT = std::numeric_limits<float>::infinity();
+        for (uint32_t id = 1; id < DYN_POINT_NUM; id += 2) {
+            auto v = points[id] - org;
+            auto tCntr = glm::dot(v, drc);
+            auto sqrDist = glm::dot(v, v) - tCntr * tCntr;
+            if (sqrDist <= RADIUS * RADIUS)
+                minT = std::min(minT, tCntr - sqrtf(RADIUS * RADIUS - sqrDist));
+        }
+        [[maybe_unused]] auto [node, datIdx, t] =
+            poctr3.QueryRay(org, drc, RADIUS);
+        if (minT == std::numeric_limits<float>::infinity())
+            assert(!node);
+        else
+            assert(node && fabsf(t - minT) <= 1e-5f);
+    }
+
+    // Snapshot test
+    auto snapshotPath =
+        (std::filesystem::temp_directory_path() / "point_octree.snapshot")
+            .string();
+    PointOctreeSnapshot<uint32_t>::Write(poctr3, snapshotPath);
+    {
+        PointOctreeSnapshot<uint32_t> snapshot(snapshotPath);
+        assert(snapshot.GetDatNum() == DYN_POINT_NUM / 2);
+        for (uint32_t id = 0; id < DYN_POINT_NUM; ++id) {
+            [[maybe_unused]] auto dat = snapshot.Query(points[id]);
+            if (id % 2 == 0)
+                assert(!dat);
+            else
+                assert(dat && *dat == id);
+        }
+        auto snapshotSelectedDat = snapshot.QueryDat(frustum);
+        std::sort(snapshotSelectedDat.begin(), snapshotSelectedDat.end());
+        assert(snapshotSelectedDat == inFrustum);
+    }
+    std::filesystem::remove(snapshotPath);
+
+    // Snapshot test with odd-sized data, whose positions need padding
+    {
+        PointOctree<uint16_t> poctr16(min, max);
+        for (uint16_t id = 0; id < 3; ++id)
+            poctr16.Insert(points[id], id);
+        PointOctreeSnapshot<uint16_t>::Write(poctr16, snapshotPath);
+        PointOctreeSnapshot<uint16_t> snapshot(snapshotPath);
+        assert(snapshot.GetDatNum() == 3);
+        for (uint16_t id = 0; id < 3; ++id) {
+            [[maybe_unused]] auto dat = snapshot.Query(points[id]);
+            assert(dat && *dat == id);
+        }
+    }
+    std::filesystem::remove(snapshotPath);
+
     return 0;
 }
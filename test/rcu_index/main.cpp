@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <util/hash_grid.hpp>
+#include <util/rcu_index.hpp>
+
+using namespace kouek;
+
+int main() {
+    auto [min, max] = std::pair{glm::vec3{-1.f}, glm::vec3{1.f}};
+    constexpr uint32_t POINT_NUM = 2000;
+    constexpr uint32_t VERSION_NUM = 200;
+    constexpr uint32_t READER_NUM = 4;
+
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<glm::vec3> points;
+    for (uint32_t id = 0; id < POINT_NUM; ++id)
+        points.emplace_back(uniform(random), uniform(random), uniform(random));
+
+    // every point of version v carries v, so a torn read is detectable
+    auto build = [&](uint32_t version) {
+        std::vector<std::pair<glm::vec3, uint32_t>> dat;
+        for (auto &pos : points)
+            dat.emplace_back(pos, version);
+        return std::make_unique<HashGrid<uint32_t>>(min, max, std::move(dat),
+                                                    0, 1);
+    };
+
+    RCUIndex<HashGrid<uint32_t>> rcuIdx;
+    assert(!rcuIdx.Pin());
+
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> readers;
+    std::atomic<uint64_t> readNum = 0;
+    for (uint32_t rIdx = 0; rIdx < READER_NUM; ++rIdx)
+        readers.emplace_back([&, rIdx]() {
+            std::minstd_rand random(rIdx);
+            std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+            uint32_t lastVersion = 0;
+            while (!stop.load()) {
+                auto guard = rcuIdx.Pin();
+                if (!guard)
+                    continue;
+                auto selected = guard->QueryDat(
+                    glm::vec3{uniform(random), uniform(random),
+                              uniform(random)},
+                    .5f);
+                if (selected.empty())
+                    continue;
+                [[maybe_unused]] auto version = selected.front();
+                assert(std::all_of(selected.begin(), selected.end(),
+                                   [&](uint32_t v) { return v == version; }));
+                assert(version >= lastVersion);
+                lastVersion = version;
+                ++readNum;
+            }
+        });
+
+    for (uint32_t version = 1; version <= VERSION_NUM; ++version)
+        rcuIdx.Publish(build(version));
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+
+    {
+        auto guard = rcuIdx.Pin();
+        assert(guard->QueryDat(glm::vec3{0}, 2.f).front() == VERSION_NUM);
+    }
+    rcuIdx.Reclaim();
+    assert(rcuIdx.GetRetiredNum() == 0);
+    std::cout << "reads " << readNum << " during " << VERSION_NUM
+              << " publishes" << std::endl;
+
+    return 0;
+}
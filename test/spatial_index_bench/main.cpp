@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <util/point_octree.hpp>
+#include <util/point_octree_snapshot.hpp>
+#include <util/trajectory_index.hpp>
+
+using namespace kouek;
+
+template <uint8_t LeafCap>
+void benchLeafCap(const std::vector<glm::vec3> &points,
+                  const glm::vec3 &min, const glm::vec3 &max) {
+    using Clock = std::chrono::steady_clock;
+
+    PointOctree<uint32_t, LeafCap> poctr(min, max);
+    auto start = Clock::now();
+    for (uint32_t id = 0; id < points.size(); ++id)
+        poctr.Insert(points[id], id);
+    auto insertDur = Clock::now() - start;
+
+    size_t hitCnt = 0;
+    start = Clock::now();
+    for (uint32_t id = 0; id < points.size(); ++id)
+        if (poctr.Query(points[id]).first)
+            ++hitCnt;
+    auto queryDur = Clock::now() - start;
+
+    auto stats = poctr.GetStats();
+
+    auto perPoint = [&](Clock::duration dur) {
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   dur)
+                   .count() /
+               points.size();
+    };
+    std::cout << "LeafCap " << (uint32_t)LeafCap << "\tinsert "
+              << perPoint(insertDur) << " ns/pt\tquery " << perPoint(queryDur)
+              << " ns/pt\thit " << hitCnt << '/' << points.size()
+              << "\tdepth " << stats.nodeDepthHist.size() << "\tnode MB "
+              << stats.nodeBytes / (1024. * 1024.) << "\tpayload used "
+              << 100. * stats.usedPayloadBytes / stats.allocPayloadBytes << '%'
+              << std::endl;
+}
+
+template <uint8_t LeafCap>
+void benchUpdate(std::vector<glm::vec3> points, const glm::vec3 &min,
+                 const glm::vec3 &max, float movedRatio) {
+    using Clock = std::chrono::steady_clock;
+    constexpr float MAX_STEP = .01f;
+
+    PointOctree<uint32_t, LeafCap> poctr(min, max);
+    for (uint32_t id = 0; id < points.size(); ++id)
+        poctr.Insert(points[id], id);
+
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> step(-MAX_STEP, MAX_STEP);
+    auto movedNum = static_cast<uint32_t>(points.size() * movedRatio);
+    std::vector<glm::vec3> newPoints(points.begin(),
+                                     points.begin() + movedNum);
+    for (auto &pos : newPoints)
+        pos = glm::clamp(
+            pos + glm::vec3{step(random), step(random), step(random)}, min,
+            max);
+
+    auto start = Clock::now();
+    for (uint32_t id = 0; id < movedNum; ++id)
+        poctr.Update(points[id], newPoints[id]);
+    auto updateDur = Clock::now() - start;
+
+    std::copy(newPoints.begin(), newPoints.end(), points.begin());
+    start = Clock::now();
+    {
+        PointOctree<uint32_t, LeafCap> rebuilt(min, max);
+        for (uint32_t id = 0; id < points.size(); ++id)
+            rebuilt.Insert(points[id], id);
+    }
+    auto rebuildDur = Clock::now() - start;
+
+    auto toMS = [](Clock::duration dur) {
+        return std::chrono::duration<double, std::milli>(dur).count();
+    };
+    std::cout << "LeafCap " << (uint32_t)LeafCap << "\tmoved "
+              << movedRatio * 100.f << "%\tupdate " << toMS(updateDur)
+              << " ms\trebuild " << toMS(rebuildDur) << " ms" << std::endl;
+}
+
+/// <summary>
+/// Frustum from (0,0,1) looking at -Z, whose side faces pass through
+/// (+-halfWid, +-halfWid, 0)
+/// </summary>
+Frustum makeFrustum(float halfWid) {
+    glm::vec3 pos{0, 0, 1.f};
+    auto drc = [&](float x, float y) {
+        return glm::vec3(
+            glm::lookAt(pos, glm::vec3{x, y, 0}, glm::vec3{0, 1.f, 0}) *
+            glm::vec4{0, 0, -1.f, 0});
+    };
+    return Frustum(pos, glm::vec3{0, 0, -1.f}, .01f, 10.f,
+                   drc(-halfWid, -halfWid), drc(-halfWid, +halfWid),
+                   drc(+halfWid, -halfWid), drc(+halfWid, +halfWid));
+}
+
+void benchFrustum(const std::vector<glm::vec3> &points, const glm::vec3 &min,
+                  const glm::vec3 &max, float halfWid) {
+    using Clock = std::chrono::steady_clock;
+
+    PointOctree8<uint32_t> poctr(min, max);
+    for (uint32_t id = 0; id < points.size(); ++id)
+        poctr.Insert(points[id], id);
+    auto frustum = makeFrustum(halfWid);
+
+    std::vector<uint32_t> selected;
+    selected.reserve(points.size());
+    auto start = Clock::now();
+    poctr.QueryDat(frustum, selected);
+    auto octreeDur = Clock::now() - start;
+
+    std::vector<uint32_t> bruteForce;
+    bruteForce.reserve(points.size());
+    start = Clock::now();
+    for (uint32_t id = 0; id < points.size(); ++id)
+        if (frustum.IsIntersetcedWith(points[id]))
+            bruteForce.emplace_back(id);
+    auto bruteForceDur = Clock::now() - start;
+
+    std::vector<uint64_t> mask(Frustum::GetMaskWordNum(points.size()));
+    start = Clock::now();
+    frustum.IsIntersetcedWith(points.data(), points.size(), mask.data());
+    auto batchDur = Clock::now() - start;
+    size_t batchCnt = 0;
+    for (auto word : mask)
+        batchCnt += std::bitset<Frustum::MASK_BIT_NUM>(word).count();
+
+    auto toMS = [](Clock::duration dur) {
+        return std::chrono::duration<double, std::milli>(dur).count();
+    };
+    std::cout << "Frustum halfWid " << halfWid << "\tselected "
+              << selected.size() << '/' << bruteForce.size() << '/'
+              << batchCnt << "\toctree " << toMS(octreeDur)
+              << " ms\tbrute force " << toMS(bruteForceDur) << " ms\tbatch x"
+              << KOUEK_FRUSTUM_SIMD_WIDTH << ' ' << toMS(batchDur) << " ms"
+              << std::endl;
+}
+
+void benchRay(const std::vector<glm::vec3> &points, const glm::vec3 &min,
+              const glm::vec3 &max, float radius) {
+    using Clock = std::chrono::steady_clock;
+    constexpr uint32_t RAY_NUM = 1000;
+
+    PointOctree8<uint32_t> poctr(min, max);
+    for (uint32_t id = 0; id < points.size(); ++id)
+        poctr.Insert(points[id], id);
+
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<std::array<glm::vec3, 2>> rays;
+    for (uint32_t rayIdx = 0; rayIdx < RAY_NUM; ++rayIdx)
+        rays.push_back({glm::vec3{uniform(random), uniform(random), 2.f},
+                        glm::normalize(glm::vec3{uniform(random) * .2f,
+                                                 uniform(random) * .2f,
+                                                 -1.f})});
+
+    uint32_t hitNum = 0;
+    auto start = Clock::now();
+    for (auto &[org, drc] : rays)
+        if (std::get<0>(poctr.QueryRay(org, drc, radius)))
+            ++hitNum;
+    auto octreeDur = Clock::now() - start;
+
+    uint32_t bruteForceHitNum = 0;
+    start = Clock::now();
+    for (auto &[org, drc] : rays) {
+        float minT = std::numeric_limits<float>::infinity();
+        for (auto &pos : points) {
+            auto v = pos - org;
+            auto tCntr = glm::dot(v, drc);
+            auto sqrDist = glm::dot(v, v) - tCntr * tCntr;
+            if (sqrDist <= radius * radius)
+                minT = std::min(minT, tCntr - sqrtf(radius * radius - sqrDist));
+        }
+        if (minT != std::numeric_limits<float>::infinity())
+            ++bruteForceHitNum;
+    }
+    auto bruteForceDur = Clock::now() - start;
+
+    auto toUS = [](Clock::duration dur) {
+        return std::chrono::duration<double, std::micro>(dur).count();
+    };
+    std::cout << "Ray radius " << radius << "\thit " << hitNum << '/'
+              << bruteForceHitNum << "\toctree " << toUS(octreeDur) / RAY_NUM
+              << " us\tbrute force " << toUS(bruteForceDur) / RAY_NUM << " us"
+              << std::endl;
+}
+
+void benchSnapshot(const std::vector<glm::vec3> &points,
+                   const glm::vec3 &min, const glm::vec3 &max) {
+    using Clock = std::chrono::steady_clock;
+    auto toMS = [](Clock::duration dur) {
+        return std::chrono::duration<double, std::milli>(dur).count();
+    };
+    auto snapshotPath =
+        (std::filesystem::temp_directory_path() / "bench.snapshot").string();
+
+    auto start = Clock::now();
+    {
+        PointOctree8<uint32_t> poctr(min, max);
+        for (uint32_t id = 0; id < points.size(); ++id)
+            poctr.Insert(points[id], id);
+        auto buildDur = Clock::now() - start;
+
+        start = Clock::now();
+        PointOctreeSnapshot<uint32_t>::Write(poctr, snapshotPath);
+        std::cout << "Snapshot\tbuild " << toMS(buildDur) << " ms\twrite "
+                  << toMS(Clock::now() - start) << " ms";
+    }
+
+    start = Clock::now();
+    size_t hitCnt = 0;
+    {
+        PointOctreeSnapshot<uint32_t> snapshot(snapshotPath);
+        auto mapDur = Clock::now() - start;
+
+        start = Clock::now();
+        for (uint32_t id = 0; id < points.size(); ++id)
+            if (snapshot.Query(points[id]))
+                ++hitCnt;
+        std::cout << "\tmap " << toMS(mapDur) << " ms\tquery "
+                  << toMS(Clock::now() - start) << " ms\thit " << hitCnt
+                  << '/' << points.size() << std::endl;
+    }
+    std::filesystem::remove(snapshotPath);
+}
+
+void benchTrajectory(uint32_t timeCnt, uint32_t vertCnt) {
+    using Clock = std::chrono::steady_clock;
+    auto toMS = [](Clock::duration dur) {
+        return std::chrono::duration<double, std::milli>(dur).count();
+    };
+    constexpr uint32_t QUERY_NUM = 100;
+    constexpr uint32_t QUERY_SPAN = 64;
+    constexpr float MAX_STEP = .01f;
+    constexpr float QUERY_HALF_WID = .05f;
+
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::uniform_real_distribution<float> step(-MAX_STEP, MAX_STEP);
+    std::vector<std::vector<glm::vec3>> verts(timeCnt);
+    for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+        verts[0].emplace_back(uniform(random), uniform(random),
+                              uniform(random));
+    for (uint32_t t = 1; t < timeCnt; ++t)
+        for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+            verts[t].emplace_back(glm::clamp(
+                verts[t - 1][vertIdx] +
+                    glm::vec3{step(random), step(random), step(random)},
+                -1.f, 1.f));
+
+    auto start = Clock::now();
+    TrajectoryIndex trajIdx(verts);
+    auto buildDur = Clock::now() - start;
+
+    std::uniform_int_distribution<uint32_t> time(0, timeCnt - QUERY_SPAN);
+    std::vector<std::tuple<glm::vec3, uint32_t>> queries;
+    for (uint32_t qIdx = 0; qIdx < QUERY_NUM; ++qIdx)
+        queries.emplace_back(
+            glm::vec3{uniform(random), uniform(random), uniform(random)},
+            time(random));
+
+    size_t selectedNum = 0;
+    start = Clock::now();
+    for (auto &[cntr, t0] : queries)
+        selectedNum += trajIdx
+                           .Query(cntr - QUERY_HALF_WID, cntr + QUERY_HALF_WID,
+                                  t0, t0 + QUERY_SPAN - 1)
+                           .size();
+    auto queryDur = Clock::now() - start;
+
+    size_t bruteForceNum = 0;
+    start = Clock::now();
+    for (auto &[cntr, t0] : queries) {
+        auto min = cntr - QUERY_HALF_WID, max = cntr + QUERY_HALF_WID;
+        for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+            for (auto t = t0; t < t0 + QUERY_SPAN; ++t) {
+                auto &pos = verts[t][vertIdx];
+                if (pos.x >= min.x && pos.y >= min.y && pos.z >= min.z &&
+                    pos.x <= max.x && pos.y <= max.y && pos.z <= max.z) {
+                    ++bruteForceNum;
+                    break;
+                }
+            }
+    }
+    auto bruteForceDur = Clock::now() - start;
+
+    std::cout << "Trajectory T " << timeCnt << " N " << vertCnt << "\tbuild "
+              << toMS(buildDur) << " ms\tquery "
+              << toMS(queryDur) / QUERY_NUM << " ms\tbrute force "
+              << toMS(bruteForceDur) / QUERY_NUM << " ms\tselected "
+              << selectedNum << '/' << bruteForceNum << std::endl;
+}
+
+int main() {
+    auto [min, max] = std::pair{glm::vec3{-1.f}, glm::vec3{1.f}};
+    constexpr uint32_t POINT_NUM = 1000000;
+
+    std::vector<glm::vec3> points;
+    points.reserve(POINT_NUM);
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    for (uint32_t id = 0; id < POINT_NUM; ++id)
+        points.emplace_back(uniform(random), uniform(random), uniform(random));
+
+    benchLeafCap<2>(points, min, max);
+    benchLeafCap<4>(points, min, max);
+    benchLeafCap<8>(points, min, max);
+    benchLeafCap<16>(points, min, max);
+    benchLeafCap<32>(points, min, max);
+
+    for (auto movedRatio : {.01f, .1f, 1.f})
+        benchUpdate<8>(points, min, max, movedRatio);
+
+    for (auto halfWid : {.05f, .2f, 1.f})
+        benchFrustum(points, min, max, halfWid);
+
+    for (auto radius : {.001f, .01f})
+        benchRay(points, min, max, radius);
+    benchSnapshot(points, min, max);
+
+    benchTrajectory(1000, 1000);
+    benchTrajectory(1000, 10000);
+
+    return 0;
+}
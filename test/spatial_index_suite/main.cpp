@@ -0,0 +1,347 @@
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <util/hash_grid.hpp>
+#include <util/point_octree.hpp>
+
+using namespace kouek;
+
+/// <summary>
+/// Usage: BenchSpatialIndexSuite [csvPath] [maxPointNum]
+/// Every (dataset, size, operation, index) case appends one row to csvPath.
+/// The fastest index of each (dataset, size, operation) is reported at the
+/// end, where the brute-force baseline does not compete.
+/// </summary>
+class Recorder {
+  public:
+    static constexpr auto BASELINE = "brute_force";
+
+  private:
+    std::ofstream out;
+    std::map<std::tuple<std::string, size_t, std::string>,
+             std::pair<std::string, double>>
+        winners;
+
+  public:
+    Recorder(const std::string &path) : out(path) {
+        if (!out.is_open())
+            throw std::runtime_error("Cannot open file: " + path);
+        out << "dataset,point_num,operation,index,op_num,total_ms,ns_per_op,"
+               "result\n";
+    }
+    void Record(const std::string &dataset, size_t pointNum,
+                const std::string &operation, const std::string &index,
+                size_t opNum, std::chrono::steady_clock::duration dur,
+                size_t result) {
+        auto ns = std::chrono::duration<double, std::nano>(dur).count();
+        out << dataset << ',' << pointNum << ',' << operation << ',' << index
+            << ',' << opNum << ',' << ns * 1e-6 << ',' << ns / opNum << ','
+            << result << '\n';
+        std::cout << dataset << '\t' << pointNum << '\t' << operation << '\t'
+                  << index << '\t' << ns / opNum << " ns/op\tresult " << result
+                  << std::endl;
+
+        if (index == BASELINE)
+            return;
+        auto [itr, inserted] = winners.try_emplace(
+            {dataset, pointNum, operation}, index, ns / opNum);
+        if (!inserted && itr->second.second > ns / opNum)
+            itr->second = {index, ns / opNum};
+    }
+    void ReportWinners() const {
+        std::cout << "\nWinners:\n";
+        for (auto &[key, val] : winners) {
+            auto &[dataset, pointNum, operation] = key;
+            std::cout << dataset << '\t' << pointNum << '\t' << operation
+                      << '\t' << val.first << '\t' << val.second << " ns/op\n";
+        }
+        std::cout << std::flush;
+    }
+};
+
+template <typename Func> auto timeIt(Func &&func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::steady_clock::now() - start;
+}
+
+std::vector<glm::vec3> makeUniform(size_t num, std::minstd_rand &random) {
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<glm::vec3> points;
+    points.reserve(num);
+    for (size_t id = 0; id < num; ++id)
+        points.emplace_back(uniform(random), uniform(random), uniform(random));
+    return points;
+}
+std::vector<glm::vec3> makeClustered(size_t num, std::minstd_rand &random) {
+    constexpr uint32_t CLUSTER_NUM = 32;
+    constexpr float SIGMA = .05f;
+    std::uniform_real_distribution<float> uniform(-.9f, .9f);
+    std::normal_distribution<float> normal(0, SIGMA);
+    std::vector<glm::vec3> cntrs;
+    for (uint32_t cIdx = 0; cIdx < CLUSTER_NUM; ++cIdx)
+        cntrs.emplace_back(uniform(random), uniform(random), uniform(random));
+    std::vector<glm::vec3> points;
+    points.reserve(num);
+    for (size_t id = 0; id < num; ++id)
+        points.emplace_back(glm::clamp(
+            cntrs[id % CLUSTER_NUM] +
+                glm::vec3{normal(random), normal(random), normal(random)},
+            -1.f, 1.f));
+    return points;
+}
+/// <summary>
+/// Points scattered in a thin bending tube, which is how neurons lie
+/// in a worm
+/// </summary>
+std::vector<glm::vec3> makeWorm(size_t num, std::minstd_rand &random) {
+    constexpr float TUBE_RADIUS = .06f;
+    std::uniform_real_distribution<float> uniform(0, 1.f);
+    std::uniform_real_distribution<float> sym(-1.f, 1.f);
+    std::vector<glm::vec3> points;
+    points.reserve(num);
+    for (size_t id = 0; id < num; ++id) {
+        auto s = uniform(random);
+        glm::vec3 cntr{1.8f * s - .9f,
+                       .4f * sinf(glm::pi<float>() * 4.f * s),
+                       .1f * cosf(glm::pi<float>() * 2.f * s)};
+        // taper toward both ends as a worm does
+        auto radius = TUBE_RADIUS * sqrtf(sinf(glm::pi<float>() * s));
+        glm::vec3 dlt;
+        do
+            dlt = {sym(random), sym(random), sym(random)};
+        while (glm::dot(dlt, dlt) > 1.f);
+        points.emplace_back(cntr + radius * dlt);
+    }
+    return points;
+}
+
+static constexpr float RADIUS = .05f;
+
+Frustum makeFrustum(float halfWid) {
+    glm::vec3 pos{0, 0, 1.f};
+    auto drc = [&](float x, float y) {
+        return glm::vec3(
+            glm::lookAt(pos, glm::vec3{x, y, 0}, glm::vec3{0, 1.f, 0}) *
+            glm::vec4{0, 0, -1.f, 0});
+    };
+    return Frustum(pos, glm::vec3{0, 0, -1.f}, .01f, 10.f,
+                   drc(-halfWid, -halfWid), drc(-halfWid, +halfWid),
+                   drc(+halfWid, -halfWid), drc(+halfWid, +halfWid));
+}
+
+void benchOctree(Recorder &rec, const std::string &dataset,
+                 const std::vector<glm::vec3> &points,
+                 const std::vector<uint32_t> &queryIds,
+                 const std::vector<uint32_t> &radiusQueryIds,
+                 const Frustum &frustum) {
+    static constexpr auto INDEX = "octree";
+    auto [min, max] = std::pair{glm::vec3{-1.f}, glm::vec3{1.f}};
+    auto num = points.size();
+
+    auto poctr = std::make_unique<PointOctree8<uint32_t>>(min, max);
+    auto dur = timeIt([&]() {
+        for (uint32_t id = 0; id < num; ++id)
+            poctr->Insert(points[id], id);
+    });
+    rec.Record(dataset, num, "insert", INDEX, num, dur,
+               poctr->GetStats().datNum);
+
+    size_t hitNum = 0;
+    dur = timeIt([&]() {
+        for (auto id : queryIds)
+            if (poctr->Query(points[id]).first)
+                ++hitNum;
+    });
+    rec.Record(dataset, num, "point_query", INDEX, queryIds.size(), dur,
+               hitNum);
+
+    std::vector<uint32_t> selected;
+    selected.reserve(num);
+    dur = timeIt([&]() { poctr->QueryDat(frustum, selected); });
+    rec.Record(dataset, num, "frustum_query", INDEX, 1, dur, selected.size());
+
+    selected.clear();
+    dur = timeIt([&]() {
+        for (auto id : radiusQueryIds)
+            poctr->QueryDat(points[id], RADIUS, selected);
+    });
+    rec.Record(dataset, num, "radius_query", INDEX, radiusQueryIds.size(), dur,
+               selected.size());
+
+    dur = timeIt([&]() { poctr.reset(); });
+    rec.Record(dataset, num, "teardown", INDEX, num, dur, 0);
+
+    std::vector<std::pair<glm::vec3, uint32_t>> dat;
+    dat.reserve(num);
+    for (uint32_t id = 0; id < num; ++id)
+        dat.emplace_back(points[id], id);
+    dur = timeIt([&]() {
+        poctr = std::make_unique<PointOctree8<uint32_t>>(min, max,
+                                                         std::move(dat));
+    });
+    rec.Record(dataset, num, "bulk_build", INDEX, num, dur,
+               poctr->GetStats().datNum);
+}
+
+void benchHashGrid(Recorder &rec, const std::string &dataset,
+                   const std::vector<glm::vec3> &points,
+                   const std::vector<uint32_t> &queryIds,
+                   const std::vector<uint32_t> &radiusQueryIds,
+                   const Frustum &frustum) {
+    static constexpr auto INDEX = "hash_grid";
+    auto [min, max] = std::pair{glm::vec3{-1.f}, glm::vec3{1.f}};
+    auto num = points.size();
+
+    std::vector<std::pair<glm::vec3, uint32_t>> dat;
+    dat.reserve(num);
+    for (uint32_t id = 0; id < num; ++id)
+        dat.emplace_back(points[id], id);
+    std::unique_ptr<HashGrid<uint32_t>> grid;
+    auto dur = timeIt([&]() {
+        grid = std::make_unique<HashGrid<uint32_t>>(min, max, std::move(dat));
+    });
+    rec.Record(dataset, num, "bulk_build", INDEX, num, dur,
+               grid->GetDatNum());
+
+    size_t hitNum = 0;
+    dur = timeIt([&]() {
+        for (auto id : queryIds)
+            if (grid->Query(points[id]))
+                ++hitNum;
+    });
+    rec.Record(dataset, num, "point_query", INDEX, queryIds.size(), dur,
+               hitNum);
+
+    std::vector<uint32_t> selected;
+    selected.reserve(num);
+    dur = timeIt([&]() { grid->QueryDat(frustum, selected); });
+    rec.Record(dataset, num, "frustum_query", INDEX, 1, dur, selected.size());
+
+    selected.clear();
+    dur = timeIt([&]() {
+        for (auto id : radiusQueryIds)
+            grid->QueryDat(points[id], RADIUS, selected);
+    });
+    rec.Record(dataset, num, "radius_query", INDEX, radiusQueryIds.size(), dur,
+               selected.size());
+
+    dur = timeIt([&]() { grid.reset(); });
+    rec.Record(dataset, num, "teardown", INDEX, num, dur, 0);
+}
+
+void benchBruteForce(Recorder &rec, const std::string &dataset,
+                     const std::vector<glm::vec3> &points,
+                     const std::vector<uint32_t> &queryIds,
+                     const std::vector<uint32_t> &radiusQueryIds,
+                     const Frustum &frustum) {
+    static constexpr auto INDEX = Recorder::BASELINE;
+    // a linear scan per point query is too slow for all queries
+    static constexpr size_t MAX_QUERY_NUM = 100;
+    auto num = points.size();
+
+    auto vec = std::make_unique<std::vector<std::pair<glm::vec3, uint32_t>>>();
+    auto dur = timeIt([&]() {
+        for (uint32_t id = 0; id < num; ++id)
+            vec->emplace_back(points[id], id);
+    });
+    rec.Record(dataset, num, "insert", INDEX, num, dur, vec->size());
+
+    size_t hitNum = 0;
+    auto queryNum = std::min(queryIds.size(), MAX_QUERY_NUM);
+    dur = timeIt([&]() {
+        for (size_t qIdx = 0; qIdx < queryNum; ++qIdx) {
+            auto &pos = points[queryIds[qIdx]];
+            for (auto &[p, id] : *vec) {
+                auto dlt = p - pos;
+                if (glm::dot(dlt, dlt) <=
+                    std::numeric_limits<float>::epsilon()) {
+                    ++hitNum;
+                    break;
+                }
+            }
+        }
+    });
+    rec.Record(dataset, num, "point_query", INDEX, queryNum, dur, hitNum);
+
+    std::vector<uint32_t> selected;
+    selected.reserve(num);
+    dur = timeIt([&]() {
+        for (auto &[p, id] : *vec)
+            if (frustum.IsIntersetcedWith(p))
+                selected.emplace_back(id);
+    });
+    rec.Record(dataset, num, "frustum_query", INDEX, 1, dur, selected.size());
+
+    selected.clear();
+    queryNum = std::min(radiusQueryIds.size(), MAX_QUERY_NUM);
+    dur = timeIt([&]() {
+        for (size_t qIdx = 0; qIdx < queryNum; ++qIdx) {
+            auto &cntr = points[radiusQueryIds[qIdx]];
+            for (auto &[p, id] : *vec) {
+                auto dlt = p - cntr;
+                if (glm::dot(dlt, dlt) <= RADIUS * RADIUS)
+                    selected.emplace_back(id);
+            }
+        }
+    });
+    rec.Record(dataset, num, "radius_query", INDEX, queryNum, dur,
+               selected.size());
+
+    dur = timeIt([&]() { vec.reset(); });
+    rec.Record(dataset, num, "teardown", INDEX, num, dur, 0);
+
+    dur = timeIt([&]() {
+        vec = std::make_unique<std::vector<std::pair<glm::vec3, uint32_t>>>();
+        vec->reserve(num);
+        for (uint32_t id = 0; id < num; ++id)
+            vec->emplace_back(points[id], id);
+    });
+    rec.Record(dataset, num, "bulk_build", INDEX, num, dur, vec->size());
+}
+
+int main(int argc, char **argv) {
+    constexpr size_t MAX_QUERY_NUM = 100000;
+    constexpr size_t MAX_RADIUS_QUERY_NUM = 1000;
+
+    std::string csvPath = argc > 1 ? argv[1] : "spatial_index_suite.csv";
+    size_t maxPointNum = argc > 2 ? std::stoull(argv[2]) : 10000000;
+
+    Recorder rec(csvPath);
+    std::minstd_rand random;
+    auto frustum = makeFrustum(.2f);
+    std::array<std::pair<std::string, std::function<std::vector<glm::vec3>(
+                                          size_t, std::minstd_rand &)>>,
+               3>
+        datasets{std::pair{"uniform", makeUniform},
+                 std::pair{"clustered", makeClustered},
+                 std::pair{"worm", makeWorm}};
+    for (auto &[name, make] : datasets)
+        for (size_t num = 1000; num <= maxPointNum; num *= 10) {
+            auto points = make(num, random);
+            std::uniform_int_distribution<uint32_t> idDist(0, num - 1);
+            std::vector<uint32_t> queryIds(std::min(num, MAX_QUERY_NUM));
+            for (auto &id : queryIds)
+                id = idDist(random);
+            std::vector<uint32_t> radiusQueryIds(
+                queryIds.begin(),
+                queryIds.begin() + std::min(num, MAX_RADIUS_QUERY_NUM));
+
+            benchOctree(rec, name, points, queryIds, radiusQueryIds, frustum);
+            benchHashGrid(rec, name, points, queryIds, radiusQueryIds,
+                          frustum);
+            benchBruteForce(rec, name, points, queryIds, radiusQueryIds,
+                            frustum);
+        }
+    rec.ReportWinners();
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <util/trace.hpp>
+
+using namespace kouek;
+
+static size_t countOccurrences(const std::string &str, const std::string &sub) {
+    size_t cnt = 0;
+    for (auto pos = str.find(sub); pos != std::string::npos;
+         pos = str.find(sub, pos + sub.size()))
+        ++cnt;
+    return cnt;
+}
+
+int main() {
+    // more than one chunk per thread
+    constexpr uint32_t SPAN_NUM = Tracer::CHUNK_EVENT_NUM + 100;
+    constexpr uint32_t WRITER_NUM = 4;
+    const auto PATH =
+        (std::filesystem::temp_directory_path() / "kouek_test_trace.json")
+            .string();
+
+    auto &tracer = Tracer::Instance();
+    {
+        KOUEK_TRACE_SCOPE("test", "Disabled");
+    }
+
+    tracer.SetEnabled(true);
+    std::atomic<bool> stop = false;
+    // flushing concurrently with writers should be safe
+    std::thread flusher([&]() {
+        while (!stop)
+            tracer.FlushToJSON(PATH);
+    });
+    std::vector<std::thread> writers;
+    for (uint32_t w = 0; w < WRITER_NUM; ++w)
+        writers.emplace_back([&]() {
+            for (uint32_t i = 0; i < SPAN_NUM; ++i) {
+                KOUEK_TRACE_SCOPE("test", "Outer");
+                KOUEK_TRACE_SCOPE("test", "Inner \"quoted\"");
+            }
+        });
+    for (auto &writer : writers)
+        writer.join();
+    stop = true;
+    flusher.join();
+    tracer.SetEnabled(false);
+
+    [[maybe_unused]] bool flushed = tracer.FlushToJSON(PATH);
+    assert(flushed);
+    std::string json;
+    {
+        std::ifstream in(PATH);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        json = ss.str();
+    }
+    std::filesystem::remove(PATH);
+    assert(countOccurrences(json, "\"name\":\"Disabled\"") == 0);
+    assert(countOccurrences(json, "\"name\":\"Outer\"") ==
+           WRITER_NUM * SPAN_NUM);
+    assert(countOccurrences(json, "\"name\":\"Inner \\\"quoted\\\"\"") ==
+           WRITER_NUM * SPAN_NUM);
+    assert(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+    assert(json.substr(json.size() - 4) == "\n]}\n");
+    std::cout << "recorded " << countOccurrences(json, "\"ph\":\"X\"")
+              << " spans" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <util/trajectory_index.hpp>
+
+using namespace kouek;
+
+int main() {
+    constexpr uint32_t TIME_CNT = 203;
+    constexpr uint32_t VERT_CNT = 300;
+    constexpr uint32_t QUERY_NUM = 500;
+    constexpr float MAX_STEP = .02f;
+
+    // random walks in [-1, 1]^3
+    std::minstd_rand random;
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::uniform_real_distribution<float> step(-MAX_STEP, MAX_STEP);
+    std::vector<std::vector<glm::vec3>> verts(TIME_CNT);
+    for (uint32_t vertIdx = 0; vertIdx < VERT_CNT; ++vertIdx)
+        verts[0].emplace_back(uniform(random), uniform(random),
+                              uniform(random));
+    for (uint32_t t = 1; t < TIME_CNT; ++t)
+        for (uint32_t vertIdx = 0; vertIdx < VERT_CNT; ++vertIdx)
+            verts[t].emplace_back(glm::clamp(
+                verts[t - 1][vertIdx] +
+                    glm::vec3{step(random), step(random), step(random)},
+                -1.f, 1.f));
+    // a static trajectory pair sharing the same AABB center
+    verts[0].emplace_back(0, 0, 0);
+    verts[0].emplace_back(0, 0, 0);
+    for (uint32_t t = 1; t < TIME_CNT; ++t) {
+        verts[t].emplace_back(0, 0, 0);
+        verts[t].emplace_back(0, 0, 0);
+    }
+
+    for (uint32_t leafSpan : {1, 4, 8, 16}) {
+        TrajectoryIndex trajIdx(verts, leafSpan);
+        std::uniform_int_distribution<uint32_t> time(0, TIME_CNT - 1);
+        std::uniform_real_distribution<float> halfWid(.01f, .5f);
+        for (uint32_t qIdx = 0; qIdx < QUERY_NUM; ++qIdx) {
+            glm::vec3 cntr{uniform(random), uniform(random), uniform(random)};
+            auto min = cntr - halfWid(random);
+            auto max = cntr + halfWid(random);
+            auto t0 = time(random), t1 = time(random);
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            std::vector<uint32_t> bruteForce;
+            for (uint32_t vertIdx = 0; vertIdx < verts[0].size(); ++vertIdx)
+                for (auto t = t0; t <= t1; ++t) {
+                    auto &pos = verts[t][vertIdx];
+                    if (pos.x >= min.x && pos.y >= min.y && pos.z >= min.z &&
+                        pos.x <= max.x && pos.y <= max.y && pos.z <= max.z) {
+                        bruteForce.emplace_back(vertIdx);
+                        break;
+                    }
+                }
+            [[maybe_unused]] auto selected = trajIdx.Query(min, max, t0, t1);
+            assert(selected == bruteForce);
+        }
+        // frustum queries are conservative, thus only supersets are checked
+        std::uniform_real_distribution<float> fovy(.1f, 1.5f);
+        for (uint32_t qIdx = 0; qIdx < QUERY_NUM; ++qIdx) {
+            glm::vec3 eye{uniform(random), uniform(random), uniform(random)};
+            glm::vec3 at{uniform(random), uniform(random), uniform(random)};
+            Frustum frustum(glm::perspective(fovy(random), 1.f, .1f, 2.f) *
+                            glm::lookAt(2.f * eye, at, glm::vec3{0, 1.f, 0}));
+            auto t0 = time(random), t1 = time(random);
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            auto selected = trajIdx.Query(frustum, t0, t1);
+            for (uint32_t vertIdx = 0; vertIdx < verts[0].size(); ++vertIdx)
+                for (auto t = t0; t <= t1; ++t)
+                    if (frustum.IsIntersetcedWith(verts[t][vertIdx])) {
+                        [[maybe_unused]] auto found = std::binary_search(
+                            selected.begin(), selected.end(), vertIdx);
+                        assert(found);
+                        break;
+                    }
+        }
+        [[maybe_unused]] auto selected =
+            trajIdx.Query(glm::vec3{-.1f}, glm::vec3{.1f}, 0, TIME_CNT);
+        assert(selected.size() >= 2 && selected.back() == VERT_CNT + 1);
+    }
+
+    return 0;
+}